@@ -0,0 +1,106 @@
+/* Checks that the chunked body decoder yields the same body however the input is split into reads,
+   then measures its throughput for a body of 1 KiB chunks fed in socket-sized reads
+
+   usage: build/bench/chunked_decoder [rounds] */
+
+#include "http_request_parser.hpp"
+
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+/* Number of 1 KiB chunks in the request body */
+#define CHUNK_COUNT 90
+
+/* Size of the reads fed to the parser, which matches a typical socket read */
+#define READ_SIZE 8192
+
+/* Builds the chunked request and the body it decodes to; a few odd chunk sizes, extensions and
+   hexadecimal cases are mixed in so that frame boundaries fall everywhere */
+static std::string buildRequest(std::string &outBody)
+{
+    std::string frames;
+    for (size_t index = 0; index < CHUNK_COUNT; index++)
+    {
+        std::string data(1024, static_cast<char>('A' + index % 26));
+        if (index % 30 == 7)
+            frames += "400;name=value\r\n" + data + "\r\n";
+        else
+            frames += "400\r\n" + data + "\r\n";
+        outBody += data;
+    }
+    frames += "1\r\nx\r\nfF\r\n" + std::string(0xff, 'y') + "\r\n";
+    outBody += "x" + std::string(0xff, 'y');
+    frames += "0\r\n\r\n";
+    return "POST /upload HTTP/1.1\r\nHost: localhost\r\nTransfer-Encoding: chunked\r\n\r\n" + frames;
+}
+
+/* Feeds the request to the parser in reads of the given size, or of random sizes up to it if `isRandom`
+   is set; returns whether the request completed with the expected body */
+static bool decodeRequest(HttpRequestParser &parser, const std::string &request, const std::string &body,
+                          size_t readSize, bool isRandom)
+{
+    parser.reset();
+    size_t offset = 0;
+    bool   isFinal = false;
+    while (offset < request.size() && !isFinal)
+    {
+        size_t length = isRandom ? 1 + std::rand() % readSize : readSize;
+        if (length > request.size() - offset)
+            length = request.size() - offset;
+        Slice data(&request[offset], length);
+        isFinal = parser.commit(data);
+        offset += length - data.getLength();
+    }
+    if (parser.getPhase() != HTTP_REQUEST_COMPLETED)
+        return false;
+    const std::vector<uint8_t> &result = parser.getRequest().body;
+    return result.size() == body.size() && std::string(result.begin(), result.end()) == body;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t rounds = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 20000;
+
+    // The pools are sized like a server's with the default configuration
+    ServerConfig      config;
+    BufferPool        pool(config.headerBufferSize);
+    BufferPool        largePool(config.largeHeaderBufferSize);
+    BufferPool        arenaPool(BUFFER_POOL_BUFFER_SIZE);
+    Arena             arena(arenaPool);
+    HttpRequestParser parser(config, 0, 0, pool, largePool, arena);
+
+    std::string body;
+    std::string request = buildRequest(body);
+
+    // Every fixed read size up to a bit more than a frame, then random splits
+    size_t checks = 0;
+    for (size_t readSize = 1; readSize <= 1100; readSize++, checks++)
+    {
+        if (!decodeRequest(parser, request, body, readSize, false))
+        {
+            std::printf("equivalence: FAILED with reads of %lu bytes\n", static_cast<unsigned long>(readSize));
+            return 1;
+        }
+    }
+    std::srand(42);
+    for (size_t index = 0; index < 1000; index++, checks++)
+    {
+        if (!decodeRequest(parser, request, body, 1 + index % 3000, true))
+        {
+            std::printf("equivalence: FAILED with random reads (round %lu)\n", static_cast<unsigned long>(index));
+            return 1;
+        }
+    }
+    std::printf("equivalence: %lu splits decoded the same body\n", static_cast<unsigned long>(checks));
+
+    clock_t start = std::clock();
+    for (size_t index = 0; index < rounds; index++)
+        decodeRequest(parser, request, body, READ_SIZE, false);
+    double seconds = static_cast<double>(std::clock() - start) / CLOCKS_PER_SEC;
+    std::printf("throughput: %.0f MB/s (%lu requests of %lu bytes)\n",
+                static_cast<double>(rounds) * request.size() / seconds / 1e6,
+                static_cast<unsigned long>(rounds), static_cast<unsigned long>(request.size()));
+    return 0;
+}
@@ -0,0 +1,114 @@
+/* Opens idle connections to a running server and reports how much its resident memory grew, which is
+   the per-connection cost that matters for C100K; the server and this tool both need a descriptor limit
+   above the connection count (eg. `ulimit -n 200000`) and the server a `client_header_timeout` longer
+   than the run
+
+   usage: build/bench/idle_connections <server-pid> <port> <connection-count> */
+
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+/* Gets the resident set size of the given process in KiB, or zero if it can not be read */
+static size_t readResidentSize(const std::string &pid)
+{
+    std::ifstream stream(("/proc/" + pid + "/status").c_str());
+    std::string   line;
+    while (std::getline(stream, line))
+    {
+        if (line.compare(0, 6, "VmRSS:") == 0)
+            return std::strtoul(line.c_str() + 6, NULL, 10);
+    }
+    return 0;
+}
+
+/* Connects to the server from a distinct loopback address, so that the ephemeral ports of a single
+   source address do not limit the connection count; returns -1 on failure */
+static int openConnection(size_t index, uint16_t port)
+{
+    int fileno = socket(AF_INET, SOCK_STREAM, 0);
+    if (fileno < 0)
+        return -1;
+
+    // 127.0.0.1 is left to the server, the clients use 127.1.0.1 and onwards with 250 clients per address
+    size_t      address = (1u << 16) + 1 + index / 250;
+    sockaddr_in source;
+    std::memset(&source, 0, sizeof(source));
+    source.sin_family      = AF_INET;
+    source.sin_addr.s_addr = htonl((127u << 24) | static_cast<uint32_t>(address));
+
+    sockaddr_in destination;
+    std::memset(&destination, 0, sizeof(destination));
+    destination.sin_family      = AF_INET;
+    destination.sin_port        = htons(port);
+    destination.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (bind(fileno, (sockaddr *)&source, sizeof(source)) != 0
+     || connect(fileno, (sockaddr *)&destination, sizeof(destination)) != 0)
+    {
+        close(fileno);
+        return -1;
+    }
+    return fileno;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 4)
+    {
+        std::fprintf(stderr, "usage: %s <server-pid> <port> <connection-count>\n", argv[0]);
+        return 1;
+    }
+    std::string pid = argv[1];
+    uint16_t    port = static_cast<uint16_t>(std::atoi(argv[2]));
+    size_t      count = std::strtoul(argv[3], NULL, 10);
+
+    // Allow as many descriptors as the hard limit permits
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    size_t before = readResidentSize(pid);
+    if (before == 0)
+    {
+        std::fprintf(stderr, "Unable to read the resident size of process %s\n", pid.c_str());
+        return 1;
+    }
+
+    std::vector<int> filenos;
+    filenos.reserve(count);
+    for (size_t index = 0; index < count; index++)
+    {
+        int fileno = openConnection(index, port);
+        if (fileno < 0)
+        {
+            std::perror("connect");
+            break;
+        }
+        filenos.push_back(fileno);
+    }
+
+    // Let the server accept the whole backlog before measuring
+    sleep(2);
+    size_t after = readResidentSize(pid);
+
+    std::printf("connections:       %lu\n", static_cast<unsigned long>(filenos.size()));
+    std::printf("rss before:        %lu KiB\n", static_cast<unsigned long>(before));
+    std::printf("rss after:         %lu KiB\n", static_cast<unsigned long>(after));
+    if (!filenos.empty() && after >= before)
+        std::printf("bytes/connection:  %lu\n", static_cast<unsigned long>((after - before) * 1024 / filenos.size()));
+
+    for (size_t index = 0; index < filenos.size(); index++)
+        close(filenos[index]);
+    return filenos.size() == count ? 0 : 1;
+}
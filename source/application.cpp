@@ -1,10 +1,23 @@
 #include "application.hpp"
 #include "endpoint.hpp"
 #include "signal_manager.hpp"
+#include "html_generator.hpp"
+#include "error_db.hpp"
+#include "mime_db.hpp"
 
-/* Constructs the main application object */
-Application::Application(ApplicationConfig &config)
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <unistd.h>
+#include <algorithm>
+
+/* Constructs the main application object; the arguments are used to restart the executable */
+Application::Application(ApplicationConfig &config, char **arguments)
     : _config(config), _dispatcher(128), _clients(NULL), _cleanupClients(NULL), _wasConfigured(false)
+    , _arguments(arguments), _executablePath(BinaryUpgrade::findExecutable(arguments[0])), _upgrade(NULL), _isDraining(false), _clientCount(0)
+    , _isAtConnectionLimit(false), _reserveFileno(-1), _isOutOfFilenos(false)
+    , _bufferPool(BUFFER_POOL_BUFFER_SIZE), _taskPool(_dispatcher)
 {
     // Check if the configuration is valid
     if (config.servers.size() == 0)
@@ -15,10 +28,30 @@ Application::Application(ApplicationConfig &config)
 void Application::configure()
 {
     std::map<uint64_t, ServerConfig *> bindings;
+    std::map<uint64_t, ServerConfig *> firstServers;
+    std::map<uint64_t, int>            inheritedListeners = BinaryUpgrade::takeInheritedListeners();
 
     if (_wasConfigured)
         throw std::logic_error("Invalid usage; .configure() must only be called once");
 
+    // Assign a distinct zone to each server and route, the rate limiter keeps their clients apart
+    uint32_t limitZone = 0;
+    for (size_t index = 0; index < _config.servers.size(); index++)
+    {
+        ServerConfig &serverConfig = _config.servers[index];
+        prerenderErrorResponses(serverConfig);
+        serverConfig.limitZone = ++limitZone;
+        for (size_t routeIndex = 0; routeIndex < serverConfig.localRoutes.size(); routeIndex++)
+        {
+            LocalRouteConfig &route = serverConfig.localRoutes[routeIndex];
+            route.limitZone = ++limitZone;
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+            // Files are resolved below the opened root directory, missing roots fall back to plain paths
+            route.rootFileno = open(route.rootDirectory.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+#endif
+        }
+    }
+
     // Create a HTTP server for each configuration entry
     for (size_t index = 0; index < _config.servers.size(); index++)
     {
@@ -28,8 +61,16 @@ void Application::configure()
         const std::map<uint64_t, ServerConfig *>::iterator result = bindings.find(hostAndPort);
         if (result == bindings.end())
         {
-            // The server hasn't been bound yet, so bind it and insert the binding into the map
-            HttpServer *server = new HttpServer(*this, serverConfig);
+            // The server hasn't been bound yet, so bind it (or adopt the socket inherited from a
+            // previous process) and insert the binding into the map
+            int inheritedFileno = -1;
+            std::map<uint64_t, int>::iterator inherited = inheritedListeners.find(hostAndPort);
+            if (inherited != inheritedListeners.end())
+            {
+                inheritedFileno = inherited->second;
+                inheritedListeners.erase(inherited);
+            }
+            HttpServer *server = new HttpServer(*this, serverConfig, inheritedFileno);
             try
             {
                 _servers.push_back(server);
@@ -38,7 +79,8 @@ void Application::configure()
             {
                 delete server;
             }
-            _dispatcher.subscribe(server->getFileno(), EPOLLIN, server);
+            server->setAccepting(true);
+            firstServers[hostAndPort] = &serverConfig;
         }
         else
         {
@@ -49,26 +91,72 @@ void Application::configure()
         bindings[hostAndPort] = &serverConfig;
     }
 
+    // Index all server names of a binding on its first server, which is the one accepting the clients
+    std::map<uint64_t, ServerConfig *>::iterator first = firstServers.begin();
+    for (; first != firstServers.end(); first++)
+    {
+        for (const ServerConfig *head = first->second; head != NULL; head = head->nextEndpoint)
+        {
+            for (size_t index = 0; index < head->name.size(); index++)
+                first->second->serverNames.insert(head->name[index], head);
+        }
+        first->second->serverNames.finalize();
+    }
+
+    // Close inherited sockets which are not part of the configuration anymore
+    std::map<uint64_t, int>::iterator inherited = inheritedListeners.begin();
+    for (; inherited != inheritedListeners.end(); inherited++)
+        close(inherited->second);
+
+    // Reserve the memory of the clients which are usually connected at once, but not of a large limit that
+    // is rarely reached; CGI processes get no reservation, they are bounded by the clients and most servers
+    // never start one
+    _clientPool.reserve(std::min(_config.maxConnections, static_cast<size_t>(CLIENT_POOL_RESERVE)));
+
+    // Blocking file system operations of the clients are performed off the event loop
+    _taskPool.start(TASK_POOL_THREAD_COUNT);
+
+    acquireReserveFileno();
     _wasConfigured = true;
+
+    // Let the previous process (if any) stop accepting and drain its clients
+    BinaryUpgrade::notifyReady();
 }
 
 /* Releases all application resources */
 Application::~Application()
 {
-    // All sinks can be destroyed immediately because the dispatcher is not going to be used again
+    // All sinks can be destroyed immediately because the dispatcher is not going to be used again,
+    // the task pool outlives the clients and abandons their tasks
 
     // Destroy clients
     HttpClient *nextClient, *headClient = _clients;
     while (headClient != NULL)
     {
         nextClient = headClient->_next;
-        delete headClient;
+        _clientPool.destroy(headClient);
         headClient = nextClient;
     }
 
     // Destroy servers
     for (size_t index = 0; index < _servers.size(); index++)
         delete _servers[index];
+
+    // Stop waiting for an upgraded process
+    delete _upgrade;
+
+    // Close the routes' root directories
+    for (size_t index = 0; index < _config.servers.size(); index++)
+    {
+        std::vector<LocalRouteConfig> &routes = _config.servers[index].localRoutes;
+        for (size_t routeIndex = 0; routeIndex < routes.size(); routeIndex++)
+        {
+            if (routes[routeIndex].rootFileno >= 0)
+                close(routes[routeIndex].rootFileno);
+        }
+    }
+
+    releaseReserveFileno();
 }
 
 /* Enters the application's main loop until an exit condition occurs */
@@ -78,11 +166,29 @@ void Application::mainLoop()
         throw std::logic_error("Invalid usage; .configure() must be called before .mainLoop()");
 
     HttpClient *headClient, *nextClient;
-    while (!SignalManager::shouldQuit())
+    // After a binary upgrade, keep running until the remaining clients are served
+    while (!SignalManager::shouldQuit() && !(_isDraining && _clients == NULL))
     { 
         // Wait up to 5 seconds to dispatch any event(s)
         _dispatcher.dispatch(5000);
 
+        // Start or finish a binary upgrade
+        if (SignalManager::takeUpgradeRequest())
+            startUpgrade();
+        if (_upgrade != NULL && _upgrade->getState() != BINARY_UPGRADE_RUNNING)
+            finishUpgrade();
+
+        if (SignalManager::takeStatusRequest())
+            reportStatus();
+
+        // Without any clients to free a file descriptor, retry accepting on every iteration
+        if (_isOutOfFilenos && _clients == NULL)
+        {
+            _isOutOfFilenos = false;
+            acquireReserveFileno();
+            updateListeners();
+        }
+
         // Destroy any process with a timeout
         headClient = _clients;
         while (headClient != NULL)
@@ -94,13 +200,16 @@ void Application::mainLoop()
                     headClient->_process->handleTimeout();
             }
 
-            // Destroy the client if it is timeout
-            if (headClient->_timeout.isExpired())
+            // Destroy the client if it is timeout or too slow
+            if (headClient->_timeout.isExpired() || headClient->isTooSlow())
                 headClient->markForCleanup();
 
             headClient = headClient->_next;
         }
 
+        // Forget clients which have neither connections nor recent requests
+        _limiter.sweep();
+
         // Remove all clients that were marked for cleanup
         headClient = _cleanupClients;
         _cleanupClients = NULL;
@@ -114,11 +223,20 @@ void Application::mainLoop()
 }
 
 /* Starts to manage the given client file descriptor according to its server's config */
-void Application::takeClient(int fileno, const ServerConfig &config, uint32_t host, uint16_t port)
+void Application::takeClient(int fileno, HttpServer &server, uint32_t host, uint16_t port)
 {
-    // Wrap the client into an object
-    (void)config;
-    HttpClient *client = new HttpClient(*this, &config, fileno, host, port);
+    // Wrap the client into an object, reusing the memory of a previous one
+    void       *memory = _clientPool.allocate();
+    HttpClient *client;
+    try
+    {
+        client = new (memory) HttpClient(*this, server, fileno, host, port);
+    }
+    catch (...)
+    {
+        _clientPool.deallocate(memory);
+        throw;
+    }
 
     // Subscribe client sink to read events
     try
@@ -127,7 +245,7 @@ void Application::takeClient(int fileno, const ServerConfig &config, uint32_t ho
     }
     catch (...)
     {
-        delete client;
+        _clientPool.destroy(client);
         throw;
     }
 
@@ -137,6 +255,27 @@ void Application::takeClient(int fileno, const ServerConfig &config, uint32_t ho
     _clients = client;
     if (client->_next != NULL)
         client->_next->_previous = client;
+
+    // Count the client and stop accepting if a limit was reached
+    _clientCount++;
+    server._clientCount++;
+    updateListeners();
+
+    // Reject clients with too many connections before reading anything from them
+    const ServerConfig &config = server.getConfig();
+    if (_limiter.acquireConnection(host, config.limitZone, config.limitConnections))
+        client->_hasConnectionSlot = true;
+    else
+    {
+        try
+        {
+            client->createErrorResponse(503);
+        }
+        catch (...)
+        {
+            client->markForCleanup();
+        }
+    }
 }
 
 /* Immediately releases and destroys the given client; DO NOT use from outside of this class */
@@ -154,14 +293,33 @@ void Application::removeClient(HttpClient *client)
 
     // Unsubscribe and destroy the client
     _dispatcher.unsubscribe(client->getFileno());
-    delete client;
+    client->_server->_clientCount--;
+    if (client->_hasConnectionSlot)
+        _limiter.releaseConnection(client->_host, client->_server->getConfig().limitZone);
+    _clientPool.destroy(client);
+
+    // Accept again if the client has freed the necessary resources
+    _clientCount--;
+    _isOutOfFilenos = false;
+    acquireReserveFileno();
+    updateListeners();
 }
 
 /* Starts CGI processes for the given client */
 void Application::startCgiProcess(HttpClient *client, const HttpRequest &request, const RoutingInfo &routingInfo)
 {
-    // Create a CGI process
-    CgiProcess *process = new CgiProcess(client, request, routingInfo);
+    // Create a CGI process, reusing the memory of a previous one
+    void       *memory = _processPool.allocate();
+    CgiProcess *process;
+    try
+    {
+        process = new (memory) CgiProcess(client, request, routingInfo);
+    }
+    catch (...)
+    {
+        _processPool.deallocate(memory);
+        throw;
+    }
 
     // Subscribe the process to the dispatcher
     try
@@ -171,7 +329,7 @@ void Application::startCgiProcess(HttpClient *client, const HttpRequest &request
     }
     catch (...)
     {
-        delete process;
+        _processPool.destroy(process);
         throw;
     }
     client->_process = process;
@@ -181,6 +339,185 @@ void Application::startCgiProcess(HttpClient *client, const HttpRequest &request
 void Application::closeCgiProcess(HttpClient *client)
 {
     // Destroy the process
-    delete client->_process;
+    _processPool.destroy(client->_process);
     client->_process = NULL;
 }
+
+/* Checks a connection limit; once reached, it stays reached until the count drops below the low-water mark */
+static bool checkConnectionLimit(size_t count, size_t limit, bool wasReached)
+{
+    if (limit == 0)
+        return false;
+    if (wasReached)
+        return count >= CONNECTION_LOW_WATER(limit);
+    return count >= limit;
+}
+
+/* Pauses listeners whose connection limit was reached and resumes them below the low-water mark */
+void Application::updateListeners()
+{
+    _isAtConnectionLimit = checkConnectionLimit(_clientCount, _config.maxConnections, _isAtConnectionLimit);
+
+    for (size_t index = 0; index < _servers.size(); index++)
+    {
+        HttpServer *server = _servers[index];
+        server->_isAtConnectionLimit = checkConnectionLimit(server->_clientCount,
+            server->getConfig().maxConnections, server->_isAtConnectionLimit);
+
+        // Paused listeners leave new connections in the kernel's backlog
+        server->setAccepting(!_isDraining && !_isOutOfFilenos && !_isAtConnectionLimit
+            && !server->_isAtConnectionLimit);
+    }
+}
+
+/* Opens a spare file descriptor which is released when `accept()` runs out of descriptors */
+void Application::acquireReserveFileno()
+{
+    if (_reserveFileno < 0)
+        _reserveFileno = open("/dev/null", O_RDONLY);
+}
+
+/* Closes the spare file descriptor */
+void Application::releaseReserveFileno()
+{
+    if (_reserveFileno < 0)
+        return;
+    close(_reserveFileno);
+    _reserveFileno = -1;
+}
+
+/* Serializes a single error response, optionally compressed; returns an empty string if
+   the server does not compress the response's content type */
+static std::string serializeErrorResponse(BufferPool &pool, const ServerConfig &config, int statusCode,
+                                          const std::string &body, const std::string &contentType, bool isCompressed)
+{
+    HttpResponse response(pool);
+
+    response.initializeUnowned(statusCode, g_errorDB.getErrorType(statusCode), body);
+    response.addHeader(C_SLICE("Content-Type"), contentType);
+    if (response.isCompressible(config.gzipTypes, config.gzipMinLength))
+    {
+        response.addHeader(C_SLICE("Vary"), C_SLICE("Accept-Encoding"));
+        if (isCompressed)
+            response.compressBody();
+    }
+    else if (isCompressed)
+        return std::string();
+    response.finalizeHeader();
+    return response.serialize();
+}
+
+/* Serializes the server's error responses for every known status code, so that sending
+   an error touches neither the file system nor the allocator */
+void Application::prerenderErrorResponses(ServerConfig &config)
+{
+    const std::map<int, std::string>          &entries = g_errorDB.getEntries();
+    std::map<int, std::string>::const_iterator entry = entries.lower_bound(400);
+    for (; entry != entries.end(); entry++)
+    {
+        int         statusCode = entry->first;
+        std::string body;
+        std::string contentType = "text/html";
+
+        // The configured error page is read once, the default page is used if it can not be read
+        std::map<int, std::string>::const_iterator errorPage = config.errorPages.find(statusCode);
+        if (errorPage != config.errorPages.end())
+        {
+            std::ifstream     stream(errorPage->second.c_str(), std::ios::binary);
+            std::stringstream contents;
+            if (stream.is_open() && contents << stream.rdbuf())
+            {
+                body = contents.str();
+                contentType = g_mimeDB.getMimeType(errorPage->second);
+            }
+            else
+                std::cerr << "Unable to read error page " << errorPage->second << std::endl;
+        }
+        if (body.empty())
+            body = HtmlGenerator::errorPage(statusCode);
+
+        PrerenderedResponse &response = config.errorResponses[statusCode];
+        response.plain = serializeErrorResponse(_bufferPool, config, statusCode, body, contentType, false);
+        response.compressed = serializeErrorResponse(_bufferPool, config, statusCode, body, contentType, true);
+    }
+}
+
+/* Prints the number of clients and the listeners' state to standard output */
+void Application::reportStatus()
+{
+    std::cout << "+ Status" << std::endl;
+    std::cout << "  Clients: " << _clientCount << " (limit " << _config.maxConnections << ')' << std::endl;
+    std::cout << "  Out of file descriptors?: " << (_isOutOfFilenos ? "yes" : "no") << std::endl;
+    std::cout << "  Draining?: " << (_isDraining ? "yes" : "no") << std::endl;
+    std::cout << "  Rate limiter entries: " << _limiter.size() << std::endl;
+    std::cout << "  Compression cache: " << _compressionCache.size() << " files, "
+              << _compressionCache.getUsedCapacity() << " bytes" << std::endl;
+    std::cout << "  Directory cache: " << _directoryCache.size() << " directories, "
+              << _directoryCache.getUsedCapacity() << " bytes" << std::endl;
+    std::cout << "  Route cache: " << _routeCache.size() << " routes, "
+              << _routeCache.getHits() << " hits, " << _routeCache.getMisses() << " misses" << std::endl;
+    std::cout << "  Client pool: " << _clientPool.capacity() << " slots, " << _clientPool.getHits() << " hits, "
+              << _clientPool.getMisses() << " misses" << std::endl;
+    std::cout << "  CGI process pool: " << _processPool.capacity() << " slots, " << _processPool.getHits() << " hits, "
+              << _processPool.getMisses() << " misses" << std::endl;
+    std::cout << "  Buffer pool: " << _bufferPool.getUsedCount() << " used, "
+              << _bufferPool.getFreeCount() << " free" << std::endl;
+    std::cout << "  Task pool: " << _taskPool.getThreadCount() << " threads, "
+              << _taskPool.getPendingCount() << " pending" << std::endl;
+    for (size_t index = 0; index < _servers.size(); index++)
+    {
+        HttpServer         *server = _servers[index];
+        const ServerConfig &config = server->getConfig();
+
+        std::cout << "  + Server on " << endpoint(config.host, config.port) << std::endl;
+        std::cout << "    Clients: " << server->_clientCount << " (limit " << config.maxConnections << ')' << std::endl;
+        std::cout << "    Accepting?: " << (server->_isAccepting ? "yes" : "no") << std::endl;
+        std::cout << "    Accept queue depth: " << server->getAcceptQueueDepth() << std::endl;
+        std::cout << "    Header buffers: " << server->_headerPool.getUsedCount() << " used, "
+                  << server->_largeHeaderPool.getUsedCount() << " large used" << std::endl;
+    }
+}
+
+/* Starts a new process of the executable which takes over the listening sockets */
+void Application::startUpgrade()
+{
+    if (_upgrade != NULL || _isDraining)
+        return;
+
+    std::vector<int> listeners;
+    for (size_t index = 0; index < _servers.size(); index++)
+        listeners.push_back(_servers[index]->getFileno());
+
+    // A failed upgrade must never take down the running server
+    try
+    {
+        _upgrade = new BinaryUpgrade(_executablePath, _arguments, listeners);
+        _dispatcher.subscribe(_upgrade->getFileno(), EPOLLIN | EPOLLHUP, _upgrade);
+    }
+    catch (const std::exception &exception)
+    {
+        delete _upgrade;
+        _upgrade = NULL;
+        std::cerr << "Binary upgrade failed: " << exception.what() << std::endl;
+    }
+}
+
+/* Stops accepting clients if the new process has started, or keeps serving if it has failed */
+void Application::finishUpgrade()
+{
+    bool hasSucceeded = _upgrade->getState() == BINARY_UPGRADE_SUCCESS;
+
+    _dispatcher.unsubscribe(_upgrade->getFileno());
+    delete _upgrade;
+    _upgrade = NULL;
+
+    if (!hasSucceeded)
+    {
+        std::cerr << "Binary upgrade failed: The new process did not start" << std::endl;
+        return;
+    }
+
+    // The new process accepts on the same sockets now, stop accepting on this side of them
+    _isDraining = true;
+    updateListeners();
+}
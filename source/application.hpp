@@ -5,10 +5,23 @@
 #include "dispatcher.hpp"
 #include "http_server.hpp"
 #include "http_client.hpp"
+#include "binary_upgrade.hpp"
+#include "rate_limiter.hpp"
+#include "compression.hpp"
+#include "directory_cache.hpp"
+#include "route_cache.hpp"
+#include "buffer_pool.hpp"
+#include "object_pool.hpp"
+#include "task_pool.hpp"
 #include "utility.hpp"
 
 #include <vector>
 
+/* Once a connection limit is reached, accepting resumes when the clients drop below this mark */
+#define CONNECTION_LOW_WATER(Limit) ((Limit) - (Limit) / 10)
+
+/* Most clients whose memory is reserved at startup, the client pool grows by slabs beyond that */
+#define CLIENT_POOL_RESERVE 1024
 
 class Application
 {
@@ -17,8 +30,8 @@ public:
     friend class HttpClient;
     friend class CgiProcess;
 
-    /* Constructs the main application object */
-    Application(ApplicationConfig &config);
+    /* Constructs the main application object; the arguments are used to restart the executable */
+    Application(ApplicationConfig &config, char **arguments);
 
     /* Releases all application resources */
     ~Application();
@@ -28,6 +41,9 @@ public:
 
     /* Enters the application's main loop until an exit condition occurs */
     void mainLoop();
+
+    /* Prints the number of clients and the listeners' state to standard output */
+    void reportStatus();
 private:
     ApplicationConfig         &_config;
     Dispatcher                 _dispatcher;
@@ -35,9 +51,29 @@ private:
     HttpClient                *_clients;
     HttpClient                *_cleanupClients;
     bool                       _wasConfigured;
+    char                     **_arguments;
+    std::string                _executablePath; // Absolute path of the executable, resolved at startup
+    BinaryUpgrade             *_upgrade;
+    bool                       _isDraining;
+    size_t                     _clientCount;
+    bool                       _isAtConnectionLimit;
+    int                        _reserveFileno;
+    bool                       _isOutOfFilenos;
+    RateLimiter                _limiter;
+    CompressionCache           _compressionCache;
+    DirectoryCache             _directoryCache;
+    RouteCache                 _routeCache;
+    BufferPool                 _bufferPool;
+    ObjectPool<HttpClient>     _clientPool;
+    ObjectPool<CgiProcess>     _processPool; // Grows on demand, a client runs at most one process
+    TaskPool                   _taskPool;
+
+    /* Serializes the server's error responses for every known status code, so that sending
+       an error touches neither the file system nor the allocator */
+    void prerenderErrorResponses(ServerConfig &config);
 
     /* Starts to manage the given client file descriptor according to its server's config */
-    void takeClient(int fileno, const ServerConfig &config, uint32_t host, uint16_t port);
+    void takeClient(int fileno, HttpServer &server, uint32_t host, uint16_t port);
 
     /* Immediately releases and destroys the given client; DO NOT use from outside of this class */
     void removeClient(HttpClient *client);
@@ -47,6 +83,21 @@ private:
 
     /*Close CGI processes for the given client */
     void closeCgiProcess(HttpClient *client);
+
+    /* Pauses listeners whose connection limit was reached and resumes them below the low-water mark */
+    void updateListeners();
+
+    /* Opens a spare file descriptor which is released when `accept()` runs out of descriptors */
+    void acquireReserveFileno();
+
+    /* Closes the spare file descriptor */
+    void releaseReserveFileno();
+
+    /* Starts a new process of the executable which takes over the listening sockets */
+    void startUpgrade();
+
+    /* Stops accepting clients if the new process has started, or keeps serving if it has failed */
+    void finishUpgrade();
 };
 
 #endif // APPLICATION_hpp
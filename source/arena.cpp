@@ -0,0 +1,93 @@
+#include "arena.hpp"
+
+#include <cstring>
+#include <stdint.h>
+#include <stdexcept>
+
+/* Size of a block header including the padding that aligns the first allocation */
+#define ARENA_HEADER_SIZE ((sizeof(Block) + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT)
+
+/* Constructs an empty arena taking its blocks from the given pool */
+Arena::Arena(BufferPool &pool)
+    : _pool(pool)
+    , _blocks(NULL)
+    , _cursor(NULL)
+    , _remainder(0)
+{
+}
+
+/* Releases all blocks */
+Arena::~Arena()
+{
+    reset();
+}
+
+/* Allocates uninitialized memory, large allocations get a block of their own */
+void *Arena::allocate(size_t size)
+{
+    size = (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+    if (size <= _remainder)
+    {
+        void *result = _cursor;
+        _cursor += size;
+        _remainder -= size;
+        return result;
+    }
+
+    // Allocations which do not fit into a pooled block are placed behind the current block,
+    // so that the current block's remainder can still be used
+    size_t payload = _pool.getBufferSize() - ARENA_HEADER_SIZE;
+    if (size > payload / 2)
+    {
+        if (size > SIZE_MAX - ARENA_HEADER_SIZE)
+            throw std::length_error("Arena allocation too large");
+        Block *block = reinterpret_cast<Block *>(new char[ARENA_HEADER_SIZE + size]);
+        block->isPooled = false;
+        if (_blocks == NULL)
+        {
+            block->previous = NULL;
+            _blocks = block;
+        }
+        else
+        {
+            block->previous = _blocks->previous;
+            _blocks->previous = block;
+        }
+        return reinterpret_cast<char *>(block) + ARENA_HEADER_SIZE;
+    }
+
+    // Start a new pooled block, the rest of the current one is abandoned
+    Block *block = reinterpret_cast<Block *>(_pool.acquire());
+    block->previous = _blocks;
+    block->isPooled = true;
+    _blocks = block;
+    _cursor = reinterpret_cast<char *>(block) + ARENA_HEADER_SIZE + size;
+    _remainder = payload - size;
+    return reinterpret_cast<char *>(block) + ARENA_HEADER_SIZE;
+}
+
+/* Copies the data into the arena as a NUL-terminated string */
+const char *Arena::copyString(Slice data)
+{
+    char *result = allocateArray<char>(data.getLength() + 1);
+    if (!data.isEmpty())
+        std::memcpy(result, &data[0], data.getLength());
+    result[data.getLength()] = '\0';
+    return result;
+}
+
+/* Invalidates all allocations and returns the blocks to the pool */
+void Arena::reset()
+{
+    while (_blocks != NULL)
+    {
+        Block *previous = _blocks->previous;
+        if (_blocks->isPooled)
+            _pool.release(reinterpret_cast<char *>(_blocks));
+        else
+            delete[] reinterpret_cast<char *>(_blocks);
+        _blocks = previous;
+    }
+    _cursor = NULL;
+    _remainder = 0;
+}
@@ -0,0 +1,62 @@
+#ifndef ARENA_hpp
+#define ARENA_hpp
+
+#include "slice.hpp"
+#include "buffer_pool.hpp"
+
+#include <stddef.h>
+
+/* Alignment of every allocation made from an arena */
+#define ARENA_ALIGNMENT 16
+
+/* Bump-pointer allocator for data that lives as long as a single request; blocks are taken from
+   a buffer pool and all allocations are released at once by `reset()` */
+class Arena
+{
+public:
+    /* Constructs an empty arena taking its blocks from the given pool */
+    explicit Arena(BufferPool &pool);
+
+    /* Releases all blocks */
+    ~Arena();
+
+    /* Allocates uninitialized memory, large allocations get a block of their own */
+    void *allocate(size_t size);
+
+    /* Allocates an uninitialized array of the given type */
+    template <typename T>
+    inline T *allocateArray(size_t count)
+    {
+        return static_cast<T *>(allocate(sizeof(T) * count));
+    }
+
+    /* Copies the data into the arena as a NUL-terminated string */
+    const char *copyString(Slice data);
+
+    /* Copies the data into the arena, the copy is NUL-terminated */
+    inline Slice copy(Slice data)
+    {
+        return Slice(copyString(data), data.getLength());
+    }
+
+    /* Invalidates all allocations and returns the blocks to the pool */
+    void reset();
+private:
+    /* Header at the start of every block, followed by the allocations */
+    struct Block
+    {
+        Block *previous;
+        bool   isPooled; // Taken from the pool, otherwise allocated for a single large allocation
+    };
+
+    BufferPool &_pool;
+    Block      *_blocks; // Most recent block first
+    char       *_cursor;
+    size_t      _remainder;
+
+    /* Disable copy-construction and copy-assignment */
+    Arena(const Arena &other);
+    Arena &operator=(const Arena &other);
+};
+
+#endif // ARENA_hpp
@@ -0,0 +1,269 @@
+#include "binary_upgrade.hpp"
+#include "signal_manager.hpp"
+#include "utility.hpp"
+
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <stdlib.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <stdexcept>
+#include <sys/wait.h>
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+# include <sys/syscall.h>
+#endif // __42_LIKES_WASTING_CPU_CYCLES__
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+extern char **environ;
+
+/* Executes the executable at the given path with the given arguments as a new process which inherits
+   the given listening sockets */
+BinaryUpgrade::BinaryUpgrade(const std::string &path, char **arguments, const std::vector<int> &listeners)
+    : _state(BINARY_UPGRADE_RUNNING)
+{
+    int descriptors[2];
+
+    // The new process reports its readiness by writing to the pipe, a failed start closes it
+    if (pipe(descriptors) != 0)
+        throw std::runtime_error("Unable to create upgrade pipe");
+
+    // Everything the child needs is prepared before forking, as the child of a process with worker
+    // threads may only make async-signal-safe calls until it executes the new process
+    std::vector<std::string>  variables;
+    std::vector<const char *> environment;
+    std::vector<int>          keptFilenos;
+    try
+    {
+        prepareEnvironment(listeners, descriptors[1], variables, environment);
+        keptFilenos = listeners;
+        keptFilenos.push_back(descriptors[1]);
+        std::sort(keptFilenos.begin(), keptFilenos.end());
+    }
+    catch (...)
+    {
+        close(descriptors[0]);
+        close(descriptors[1]);
+        throw;
+    }
+    long filenoLimit = sysconf(_SC_OPEN_MAX);
+    if (filenoLimit <= 0 || filenoLimit > INT_MAX)
+        filenoLimit = INT_MAX;
+
+    if ((_pid = fork()) < 0)
+    {
+        close(descriptors[0]);
+        close(descriptors[1]);
+        throw std::runtime_error("Unable to fork upgrade process");
+    }
+
+    if (_pid == 0)
+        executeChild(path.c_str(), arguments, const_cast<char *const *>(environment.data()), keptFilenos,
+                     static_cast<int>(filenoLimit));
+
+    // Only keep the reading end of the pipe
+    close(descriptors[1]);
+    _fileno = descriptors[0];
+}
+
+/* Closes the notification pipe and kills and reaps the new process if it has failed */
+BinaryUpgrade::~BinaryUpgrade()
+{
+    close(_fileno);
+
+    // The new process usually exited already, but it may also have closed the pipe and kept running
+    if (_state == BINARY_UPGRADE_FAILURE)
+    {
+        kill(_pid, SIGKILL);
+        waitpid(_pid, NULL, 0);
+    }
+}
+
+/* Resolves the executable's first argument to an absolute path, searching the `PATH` if it has no slash;
+   the working directory and `PATH` may change before an upgrade, so this is done at startup */
+std::string BinaryUpgrade::findExecutable(const char *argument)
+{
+    std::string name(argument);
+    if (name.find('/') == std::string::npos)
+    {
+        // Shells only find executables by their name through the `PATH`, an empty entry is the working directory
+        const char *variable = getenv("PATH");
+        Slice list = variable != NULL ? Slice(variable, std::strlen(variable)) : C_SLICE("/usr/bin:/bin");
+        Slice directory;
+        while (list.getLength() > 0)
+        {
+            if (!list.splitStart(':', directory))
+            {
+                directory = list;
+                list = Slice();
+            }
+            std::string candidate = directory.isEmpty() ? name : directory.toString() + '/' + name;
+            if (access(candidate.c_str(), X_OK) == 0)
+            {
+                name = candidate;
+                break;
+            }
+        }
+    }
+    if (!name.empty() && name[0] == '/')
+        return name;
+
+    // Relative paths are resolved against the working directory at startup
+    char workingDirectory[PATH_MAX];
+    if (getcwd(workingDirectory, sizeof(workingDirectory)) == NULL)
+        throw std::runtime_error("Unable to get the working directory");
+    return std::string(workingDirectory) + '/' + name;
+}
+
+/* Takes ownership of the listening sockets passed by a previous process, keyed by host and port */
+std::map<uint64_t, int> BinaryUpgrade::takeInheritedListeners()
+{
+    std::map<uint64_t, int> result;
+
+    const char *variable = getenv(UPGRADE_LISTENERS_VARIABLE);
+    if (variable == NULL)
+        return result;
+
+    Slice list(variable, std::strlen(variable));
+    Slice item;
+    while (list.getLength() > 0)
+    {
+        if (!list.splitStart(';', item))
+        {
+            item = list;
+            list = Slice();
+        }
+
+        size_t fileno;
+        if (!Utility::parseSize(item, fileno) || fileno > INT_MAX)
+            continue;
+
+        // Ask the kernel for the socket's address instead of trusting the environment
+        sockaddr_in address;
+        socklen_t   addressLength = sizeof(address);
+        if (getsockname(static_cast<int>(fileno), (sockaddr *)&address, &addressLength) != 0)
+            continue;
+        if (address.sin_family != AF_INET)
+            continue;
+
+        // Uses the same key layout as the bindings in `Application::configure()`
+        uint64_t hostAndPort = static_cast<uint64_t>(ntohl(address.sin_addr.s_addr))
+            | (static_cast<uint64_t>(ntohs(address.sin_port)) << 32);
+        result[hostAndPort] = static_cast<int>(fileno);
+    }
+
+    return result;
+}
+
+/* Reports to the previous process (if any) that this process accepts clients now */
+void BinaryUpgrade::notifyReady()
+{
+    const char *variable = getenv(UPGRADE_NOTIFY_VARIABLE);
+    if (variable == NULL)
+        return;
+
+    size_t fileno;
+    if (!Utility::parseSize(Slice(variable, std::strlen(variable)), fileno) || fileno > INT_MAX)
+        return;
+
+    // A failed write is reported as a failed upgrade once the pipe is closed
+    ssize_t result = write(static_cast<int>(fileno), "!", 1);
+    (void)result;
+    close(static_cast<int>(fileno));
+}
+
+/* Handles one or multiple events */
+void BinaryUpgrade::handleEvents(uint32_t eventMask)
+{
+    (void)eventMask;
+
+    if (_state != BINARY_UPGRADE_RUNNING)
+        return;
+
+    char    byte;
+    ssize_t result = read(_fileno, &byte, 1);
+    if (result < 0)
+    {
+        if (SignalManager::shouldQuit())
+            return;
+        throw std::runtime_error("Unable to read from upgrade pipe");
+    }
+
+    // The pipe is closed without data when the new process exits before it is ready
+    if (result > 0)
+        _state = BINARY_UPGRADE_SUCCESS;
+    else
+        _state = BINARY_UPGRADE_FAILURE;
+}
+
+/* Handles an exception that occurred in `handleEvent()` */
+void BinaryUpgrade::handleException(const char *message)
+{
+    (void)message;
+    _state = BINARY_UPGRADE_FAILURE;
+}
+
+/* Builds the environment of the new process, which passes the inherited descriptors and replaces
+   those of earlier upgrades; `outVariables` holds the added variables */
+void BinaryUpgrade::prepareEnvironment(const std::vector<int> &listeners, int notifyFileno,
+                                       std::vector<std::string> &outVariables, std::vector<const char *> &outEnvironment)
+{
+    std::string listenersVariable = UPGRADE_LISTENERS_VARIABLE "=";
+    for (size_t index = 0; index < listeners.size(); index++)
+    {
+        if (index > 0)
+            listenersVariable += ';';
+        listenersVariable += Utility::numberToString(listeners[index]);
+    }
+    outVariables.push_back(listenersVariable);
+    outVariables.push_back(UPGRADE_NOTIFY_VARIABLE "=" + Utility::numberToString(notifyFileno));
+
+    for (char **entry = environ; *entry != NULL; entry++)
+    {
+        Slice current(*entry, std::strlen(*entry));
+        if (current.startsWith(C_SLICE(UPGRADE_LISTENERS_VARIABLE "="))
+         || current.startsWith(C_SLICE(UPGRADE_NOTIFY_VARIABLE "=")))
+            continue;
+        outEnvironment.push_back(*entry);
+    }
+    for (size_t index = 0; index < outVariables.size(); index++)
+        outEnvironment.push_back(outVariables[index].c_str());
+    outEnvironment.push_back(NULL);
+}
+
+/* Closes the descriptors from `first` to `last` (inclusive) */
+static void closeFilenoRange(int first, int last)
+{
+    if (first > last)
+        return;
+#if !defined(__42_LIKES_WASTING_CPU_CYCLES__) && defined(SYS_close_range)
+    if (syscall(SYS_close_range, first, last, 0) == 0)
+        return;
+#endif
+    for (int fileno = first; fileno <= last; fileno++)
+        close(fileno);
+}
+
+/* Executes the new process; only called in the forked child and never returns, so it only makes
+   async-signal-safe calls */
+void BinaryUpgrade::executeChild(const char *path, char **arguments, char *const *environment, const std::vector<int> &keptFilenos,
+                                 int filenoLimit)
+{
+    // Close every descriptor except the standard streams and the sorted kept ones (the listeners and the
+    // notification pipe), otherwise the new process would keep client connections and CGI pipes of this one open
+    int first = STDERR_FILENO + 1;
+    for (size_t index = 0; index < keptFilenos.size(); index++)
+    {
+        closeFilenoRange(first, keptFilenos[index] - 1);
+        if (keptFilenos[index] >= first)
+            first = keptFilenos[index] + 1;
+    }
+    closeFilenoRange(first, filenoLimit - 1);
+
+    execve(path, arguments, environment);
+
+    // If execve() ever returns, exit the process immediately
+    _exit(255);
+}
@@ -0,0 +1,81 @@
+#ifndef BINARY_UPGRADE_hpp
+#define BINARY_UPGRADE_hpp
+
+#include "dispatcher.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/* Environment variable holding the listening sockets passed to an upgraded process; eg. "3;4;7" */
+#define UPGRADE_LISTENERS_VARIABLE "WEBSERV_LISTENERS"
+
+/* Environment variable holding the pipe used by an upgraded process to report its readiness */
+#define UPGRADE_NOTIFY_VARIABLE "WEBSERV_UPGRADE_NOTIFY"
+
+enum BinaryUpgradeState
+{
+    BINARY_UPGRADE_RUNNING,
+    BINARY_UPGRADE_SUCCESS,
+    BINARY_UPGRADE_FAILURE
+};
+
+class BinaryUpgrade: public Sink
+{
+public:
+    /* Executes the executable at the given path with the given arguments as a new process which inherits
+       the given listening sockets */
+    BinaryUpgrade(const std::string &path, char **arguments, const std::vector<int> &listeners);
+
+    /* Closes the notification pipe and kills and reaps the new process if it has failed */
+    ~BinaryUpgrade();
+
+    /* Gets the file descriptor on which the new process reports its readiness */
+    inline int getFileno()
+    {
+        return _fileno;
+    }
+
+    /* Gets the upgrade's current state */
+    inline BinaryUpgradeState getState()
+    {
+        return _state;
+    }
+
+    /* Resolves the executable's first argument to an absolute path, searching the `PATH` if it has no slash;
+       the working directory and `PATH` may change before an upgrade, so this is done at startup */
+    static std::string findExecutable(const char *argument);
+
+    /* Takes ownership of the listening sockets passed by a previous process, keyed by host and port */
+    static std::map<uint64_t, int> takeInheritedListeners();
+
+    /* Reports to the previous process (if any) that this process accepts clients now */
+    static void notifyReady();
+private:
+    BinaryUpgradeState _state;
+    int                _pid;
+    int                _fileno;
+
+    /* Handles one or multiple events */
+    void handleEvents(uint32_t eventMask);
+
+    /* Handles an exception that occurred in `handleEvent()` */
+    void handleException(const char *message);
+
+    /* Builds the environment of the new process, which passes the inherited descriptors and replaces
+       those of earlier upgrades; `outVariables` holds the added variables */
+    static void prepareEnvironment(const std::vector<int> &listeners, int notifyFileno,
+                                   std::vector<std::string> &outVariables, std::vector<const char *> &outEnvironment);
+
+    /* Executes the new process; only called in the forked child and never returns, so it only makes
+       async-signal-safe calls */
+    static void executeChild(const char *path, char **arguments, char *const *environment, const std::vector<int> &keptFilenos,
+                             int filenoLimit);
+
+    /* Disable copy-construction and copy-assignment */
+    BinaryUpgrade(const BinaryUpgrade &other);
+    BinaryUpgrade &operator=(const BinaryUpgrade &other);
+};
+
+#endif // BINARY_UPGRADE_hpp
@@ -0,0 +1,51 @@
+#include "buffer_pool.hpp"
+
+/* Constructs an empty pool of buffers of the given size */
+BufferPool::BufferPool(size_t bufferSize)
+    : _bufferSize(bufferSize)
+    , _usedCount(0)
+{
+}
+
+/* Frees all released buffers; acquired ones MUST have been released already */
+BufferPool::~BufferPool()
+{
+    for (size_t index = 0; index < _freeBuffers.size(); index++)
+        delete[] _freeBuffers[index];
+}
+
+/* Takes a buffer out of the pool, allocating a new one if there is none left */
+char *BufferPool::acquire()
+{
+    char *buffer;
+    if (_freeBuffers.empty())
+        buffer = new char[_bufferSize];
+    else
+    {
+        buffer = _freeBuffers.back();
+        _freeBuffers.pop_back();
+    }
+    _usedCount++;
+    return buffer;
+}
+
+/* Returns a buffer obtained by `acquire()` to the pool */
+void BufferPool::release(char *buffer)
+{
+    _usedCount--;
+    if (_freeBuffers.size() >= BUFFER_POOL_MAX_FREE)
+    {
+        delete[] buffer;
+        return;
+    }
+
+    // Releasing must not throw, the buffer is freed instead if the vector can not grow
+    try
+    {
+        _freeBuffers.push_back(buffer);
+    }
+    catch (...)
+    {
+        delete[] buffer;
+    }
+}
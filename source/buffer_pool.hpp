@@ -0,0 +1,56 @@
+#ifndef BUFFER_POOL_hpp
+#define BUFFER_POOL_hpp
+
+#include <vector>
+#include <stddef.h>
+
+/* Size of the buffers shared by the request parsers and responses */
+#define BUFFER_POOL_BUFFER_SIZE 8192
+
+/* Maximum number of released buffers kept for reuse, further ones are freed */
+#define BUFFER_POOL_MAX_FREE 1024
+
+/* Recycles fixed-size buffers, so that connections only hold one while they are parsing or sending */
+class BufferPool
+{
+public:
+    /* Constructs an empty pool of buffers of the given size */
+    explicit BufferPool(size_t bufferSize);
+
+    /* Frees all released buffers; acquired ones MUST have been released already */
+    ~BufferPool();
+
+    /* Takes a buffer out of the pool, allocating a new one if there is none left */
+    char *acquire();
+
+    /* Returns a buffer obtained by `acquire()` to the pool */
+    void release(char *buffer);
+
+    /* Gets the size of every buffer */
+    inline size_t getBufferSize() const
+    {
+        return _bufferSize;
+    }
+
+    /* Gets the number of buffers that are currently acquired */
+    inline size_t getUsedCount() const
+    {
+        return _usedCount;
+    }
+
+    /* Gets the number of released buffers that are kept for reuse */
+    inline size_t getFreeCount() const
+    {
+        return _freeBuffers.size();
+    }
+private:
+    size_t              _bufferSize;
+    std::vector<char *> _freeBuffers;
+    size_t              _usedCount;
+
+    /* Disable copy-construction and copy-assignment */
+    BufferPool(const BufferPool &other);
+    BufferPool &operator=(const BufferPool &other);
+};
+
+#endif // BUFFER_POOL_hpp
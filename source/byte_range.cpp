@@ -0,0 +1,106 @@
+#include "byte_range.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+
+/* Orders byte ranges by their offset */
+static bool compareOffset(const ByteRange &lhs, const ByteRange &rhs)
+{
+    return lhs.offset < rhs.offset;
+}
+
+/* Constructs a byte range from its offset and length */
+ByteRange::ByteRange(size_t offset, size_t length)
+    : offset(offset)
+    , length(length)
+{
+}
+
+/* Parses the value of a `Range` header for a body of the given size,
+   overlapping and adjacent ranges are merged into a single one */
+ByteRangeStatus ByteRange::parse(Slice header, size_t size, std::vector<ByteRange> &outRanges)
+{
+    std::vector<ByteRange> ranges;
+
+    // Only byte ranges are supported, other units are ignored
+    if (!header.consumeStart(C_SLICE("bytes=")))
+        return BYTE_RANGE_IGNORED;
+
+    size_t specCount = 0;
+    while (header.getLength() > 0)
+    {
+        Slice spec;
+        if (!header.splitStart(',', spec))
+        {
+            spec = header;
+            header = Slice();
+        }
+        spec.stripStart(' ').stripEnd(' ');
+        if (spec.isEmpty())
+            continue;
+
+        // Too many ranges are more likely an attack than a legitimate request
+        if (++specCount > BYTE_RANGE_MAX_COUNT)
+            return BYTE_RANGE_IGNORED;
+
+        Slice firstSlice;
+        if (!spec.splitStart('-', firstSlice))
+            return BYTE_RANGE_IGNORED;
+
+        size_t first;
+        size_t last;
+        if (firstSlice.isEmpty())
+        {
+            // Suffix range "-N" selects the last N bytes
+            size_t suffixLength;
+            if (!Utility::parseSize(spec, suffixLength))
+                return BYTE_RANGE_IGNORED;
+            if (suffixLength == 0 || size == 0)
+                continue;
+            if (suffixLength > size)
+                suffixLength = size;
+            ranges.push_back(ByteRange(size - suffixLength, suffixLength));
+            continue;
+        }
+
+        if (!Utility::parseSize(firstSlice, first))
+            return BYTE_RANGE_IGNORED;
+        if (spec.isEmpty())
+            last = size - 1;
+        else if (!Utility::parseSize(spec, last))
+            return BYTE_RANGE_IGNORED;
+        if (last < first)
+            return BYTE_RANGE_IGNORED;
+
+        // Ranges starting beyond the end can not be satisfied, those ending beyond it are clamped
+        if (first >= size)
+            continue;
+        if (last >= size)
+            last = size - 1;
+        ranges.push_back(ByteRange(first, last - first + 1));
+    }
+
+    if (specCount == 0)
+        return BYTE_RANGE_IGNORED;
+    if (ranges.empty())
+        return BYTE_RANGE_UNSATISFIABLE;
+
+    // Merge overlapping and adjacent ranges so that no byte is sent twice
+    std::sort(ranges.begin(), ranges.end(), compareOffset);
+    outRanges.clear();
+    outRanges.push_back(ranges[0]);
+    for (size_t index = 1; index < ranges.size(); index++)
+    {
+        ByteRange &previous = outRanges.back();
+        size_t     previousEnd = previous.offset + previous.length;
+        if (ranges[index].offset <= previousEnd)
+        {
+            size_t end = ranges[index].offset + ranges[index].length;
+            if (end > previousEnd)
+                previous.length = end - previous.offset;
+        }
+        else
+            outRanges.push_back(ranges[index]);
+    }
+    return BYTE_RANGE_SATISFIABLE;
+}
@@ -0,0 +1,32 @@
+#ifndef BYTE_RANGE_hpp
+#define BYTE_RANGE_hpp
+
+#include "slice.hpp"
+
+#include <vector>
+#include <stddef.h>
+
+/* Maximum number of ranges served for a single request, more are answered with the whole body */
+#define BYTE_RANGE_MAX_COUNT 16
+
+enum ByteRangeStatus
+{
+    BYTE_RANGE_IGNORED,
+    BYTE_RANGE_SATISFIABLE,
+    BYTE_RANGE_UNSATISFIABLE
+};
+
+struct ByteRange
+{
+    size_t offset;
+    size_t length;
+
+    /* Constructs a byte range from its offset and length */
+    ByteRange(size_t offset, size_t length);
+
+    /* Parses the value of a `Range` header for a body of the given size,
+       overlapping and adjacent ranges are merged into a single one */
+    static ByteRangeStatus parse(Slice header, size_t size, std::vector<ByteRange> &outRanges);
+};
+
+#endif // BYTE_RANGE_hpp
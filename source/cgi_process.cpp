@@ -4,12 +4,14 @@
 #include "application.hpp"
 #include "signal_manager.hpp"
 
+#include <cctype>
 #include <cstring>
 #include <stdlib.h>
 #include <limits.h>
 #include <unistd.h>
 
-CgiPathInfo::CgiPathInfo(const std::string &nodePath)
+/* Splits the script's path into directory and file name, which are copied into the arena */
+CgiPathInfo::CgiPathInfo(Arena &arena, Slice nodePath)
 {
     // Split script file and directory
     Slice scriptFileSlice;
@@ -18,18 +20,18 @@ CgiPathInfo::CgiPathInfo(const std::string &nodePath)
         throw std::runtime_error("Unable to split script directory");
 
     // Populate the structure
-    fileName = scriptFileSlice.toString();
-    workingDirectory = scriptDirectorySlice.toString();
+    fileName = arena.copyString(scriptFileSlice);
+    workingDirectory = arena.copyString(scriptDirectorySlice);
 }
 
 /* Constructs a CGI process from the given client, request and route result */
 CgiProcess::CgiProcess(HttpClient *client, const HttpRequest &request, const RoutingInfo &routingInfo)
     : _state(CGI_PROCESS_RUNNING)
-    , _pathInfo(routingInfo.nodePath)
+    , _pathInfo(client->_arena, Slice(routingInfo.nodePath))
     , _client(client)
     , _request(request)
-    , _process(setupArguments(request, routingInfo, _pathInfo.fileName),
-               setupEnvironment(request, routingInfo),
+    , _process(setupArguments(client->_arena, request, routingInfo, _pathInfo.fileName),
+               setupEnvironment(client->_arena, request, routingInfo),
                _pathInfo.workingDirectory)
     , _timeout(TIMEOUT_CGI_MS)
     , _bodyOffset(0)
@@ -175,21 +177,42 @@ void CgiProcess::handleTimeout()
 }
 
 /* Creates a vector of strings for the process arguments */
-std::vector<std::string> CgiProcess::setupArguments(const HttpRequest &request, const RoutingInfo &routingInfo, const std::string &fileName)
+const char **CgiProcess::setupArguments(Arena &arena, const HttpRequest &request, const RoutingInfo &routingInfo, const char *fileName)
 {
-    (void)request;
-    std::vector<std::string> result;
-    result.push_back(routingInfo.cgiInterpreter);
-    result.push_back(fileName);
+    const char **result = arena.allocateArray<const char *>(4);
+    size_t count = 0;
+    result[count++] = arena.copyString(Slice(routingInfo.cgiInterpreter));
+    result[count++] = fileName;
     if (request.method == HTTP_METHOD_GET && !request.queryParameters.isEmpty())
-        result.push_back('?' + request.queryParameters.toString());
+    {
+        char *query = arena.allocateArray<char>(request.queryParameters.getLength() + 2);
+        query[0] = '?';
+        std::memcpy(query + 1, &request.queryParameters[0], request.queryParameters.getLength());
+        query[request.queryParameters.getLength() + 1] = '\0';
+        result[count++] = query;
+    }
+    result[count] = NULL;
     return result;
 }
 
-/* Creates a vector of strings for the process environment */
-std::vector<std::string> CgiProcess::setupEnvironment(const HttpRequest &request, const RoutingInfo &routingInfo)
+/* Writes a `NAME=value` environment variable into the arena */
+static const char *formatVariable(Arena &arena, Slice name, Slice value)
 {
-    std::vector<std::string> result;
+    char *result = arena.allocateArray<char>(name.getLength() + value.getLength() + 2);
+    if (!name.isEmpty())
+        std::memcpy(result, &name[0], name.getLength());
+    result[name.getLength()] = '=';
+    if (!value.isEmpty())
+        std::memcpy(result + name.getLength() + 1, &value[0], value.getLength());
+    result[name.getLength() + value.getLength() + 1] = '\0';
+    return result;
+}
+
+/* Creates the NULL-terminated array of process environment variables in the arena */
+const char **CgiProcess::setupEnvironment(Arena &arena, const HttpRequest &request, const RoutingInfo &routingInfo)
+{
+    const char **result = arena.allocateArray<const char *>(CGI_FIXED_VARIABLE_COUNT + request.headerCount + 1);
+    size_t count = 0;
 
     const HttpRequest::Header *contentType = request.findHeader(C_SLICE("Content-Type"));
     const HttpRequest::Header *host = request.findHeader(C_SLICE("Host"));
@@ -199,46 +222,54 @@ std::vector<std::string> CgiProcess::setupEnvironment(const HttpRequest &request
     if (!nodePath.splitEnd('/', filename))
         filename = nodePath;
 
+    char   number[UTILITY_SIZE_DIGITS];
+    size_t numberLength;
+    std::string clientHost = Utility::ipv4ToString(request.clientHost);
+
     // Add the standard CGI environment variables
-    result.push_back("AUTH_TYPE=");
-    result.push_back("CONTENT_LENGTH=" + Utility::numberToString(request.body.size()));
+    result[count++] = "AUTH_TYPE=";
+    numberLength = Utility::formatSize(request.body.size(), number);
+    result[count++] = formatVariable(arena, C_SLICE("CONTENT_LENGTH"), Slice(number, numberLength));
     if (contentType != NULL)
-        result.push_back("CONTENT_TYPE=" + contentType->getValue());
-    result.push_back("GATEWAY_INTERFACE=CGI/1.1");
-    result.push_back("PATH_INFO=");
-    result.push_back("PATH_TRANSLATED=");
-    result.push_back("QUERY_STRING=" + request.queryParameters.toString());
-    result.push_back("REMOTE_ADDR=" + Utility::ipv4ToString(request.clientHost));
-    result.push_back("REMOTE_HOST=" + Utility::ipv4ToString(request.clientHost));
-    result.push_back("REQUEST_METHOD=" + std::string(httpMethodToString(request.method)));
-    result.push_back("SCRIPT_NAME=" + request.queryPath);
-    result.push_back("SCRIPT_FILENAME=" + filename.toString());
+        result[count++] = formatVariable(arena, C_SLICE("CONTENT_TYPE"), contentType->getValue());
+    result[count++] = "GATEWAY_INTERFACE=CGI/1.1";
+    result[count++] = "PATH_INFO=";
+    result[count++] = "PATH_TRANSLATED=";
+    result[count++] = formatVariable(arena, C_SLICE("QUERY_STRING"), request.queryParameters);
+    result[count++] = formatVariable(arena, C_SLICE("REMOTE_ADDR"), Slice(clientHost));
+    result[count++] = formatVariable(arena, C_SLICE("REMOTE_HOST"), Slice(clientHost));
+    const char *method = httpMethodToString(request.method);
+    result[count++] = formatVariable(arena, C_SLICE("REQUEST_METHOD"), Slice(method, std::strlen(method)));
+    result[count++] = formatVariable(arena, C_SLICE("SCRIPT_NAME"), request.queryPath);
+    result[count++] = formatVariable(arena, C_SLICE("SCRIPT_FILENAME"), filename);
     if (host != NULL)
-        result.push_back("HTTP_HOST=" + host->getValue());
+        result[count++] = formatVariable(arena, C_SLICE("HTTP_HOST"), host->getValue());
     else
-        result.push_back("HTTP_HOST=NULL");
+        result[count++] = "HTTP_HOST=NULL";
     if (host != NULL)
-        result.push_back("SERVER_NAME=" + host->getValue());
-    result.push_back("SERVER_PORT=" + Utility::numberToString(routingInfo.serverConfig->port));
-    result.push_back("SERVER_PROTOCOL=HTTP/1.1");
-    result.push_back("SERVER_SOFTWARE=webs3rv/1.0");
-    result.push_back("REDIRECT_STATUS=200");
+        result[count++] = formatVariable(arena, C_SLICE("SERVER_NAME"), host->getValue());
+    numberLength = Utility::formatSize(routingInfo.serverConfig->port, number);
+    result[count++] = formatVariable(arena, C_SLICE("SERVER_PORT"), Slice(number, numberLength));
+    result[count++] = "SERVER_PROTOCOL=HTTP/1.1";
+    result[count++] = "SERVER_SOFTWARE=webs3rv/1.0";
+    result[count++] = "REDIRECT_STATUS=200";
 
     // Add the HTTP request headers to the environment
-    std::vector<HttpRequest::Header>::const_iterator header = request.headers.begin();
-    for (; header != request.headers.end(); header++)
+    for (size_t headerIndex = 0; headerIndex < request.headerCount; headerIndex++)
     {
-        std::string key = "HTTP_" + header->getKey();
-        std::string value = header->getValue();
-        for (size_t i = 0; i < key.size(); i++)
-        {
-            if (key[i] == '-')
-                key[i] = '_';
-            else
-                key[i] = std::toupper(key[i]);
-        }
-        result.push_back(key + "=" + value);
+        Slice key = request.headers[headerIndex].getKey();
+        Slice value = request.headers[headerIndex].getValue();
+        char *variable = arena.allocateArray<char>(5 + key.getLength() + value.getLength() + 2);
+        std::memcpy(variable, "HTTP_", 5);
+        for (size_t index = 0; index < key.getLength(); index++)
+            variable[5 + index] = key[index] == '-' ? '_' : std::toupper(static_cast<unsigned char>(key[index]));
+        variable[5 + key.getLength()] = '=';
+        if (!value.isEmpty())
+            std::memcpy(variable + 5 + key.getLength() + 1, &value[0], value.getLength());
+        variable[5 + key.getLength() + value.getLength() + 1] = '\0';
+        result[count++] = variable;
     }
 
+    result[count] = NULL;
     return result;
 }
@@ -6,6 +6,7 @@
 #include "http_client.hpp"
 #include "http_request.hpp"
 #include "utility.hpp"
+#include "arena.hpp"
 #include "routing.hpp"
 
 #include <stdint.h>
@@ -24,12 +25,16 @@ enum CgiProcessState
     CGI_PROCESS_SUCCESS,
 };
 
+/* Number of environment variables set besides the request's header fields */
+#define CGI_FIXED_VARIABLE_COUNT 18
+
 struct CgiPathInfo
 {
-    std::string workingDirectory;
-    std::string fileName;
+    const char *workingDirectory;
+    const char *fileName;
 
-    CgiPathInfo(const std::string &nodePath);
+    /* Splits the script's path into directory and file name, which are copied into the arena */
+    CgiPathInfo(Arena &arena, Slice nodePath);
 };
 
 class CgiProcess: public Sink
@@ -87,11 +92,11 @@ private:
     size_t               _bodyOffset;
     unsigned int         _subscribeFlags;
 
-    /* Creates a vector of strings for the process arguments */
-    static std::vector<std::string> setupArguments(const HttpRequest &request, const RoutingInfo &routingInfo, const std::string &fileName);
+    /* Creates the NULL-terminated array of process arguments in the arena */
+    static const char **setupArguments(Arena &arena, const HttpRequest &request, const RoutingInfo &routingInfo, const char *fileName);
 
-    /* Creates a vector of strings for the process environment */
-    static std::vector<std::string> setupEnvironment(const HttpRequest &request, const RoutingInfo &routingInfo);
+    /* Creates the NULL-terminated array of process environment variables in the arena */
+    static const char **setupEnvironment(Arena &arena, const HttpRequest &request, const RoutingInfo &routingInfo);
 };
 
 #endif // CGI_PROCESS_hpp
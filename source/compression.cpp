@@ -0,0 +1,155 @@
+#include "compression.hpp"
+
+#include <zlib.h>
+#include <cstdio>
+#include <fstream>
+#include <cstring>
+
+/* Compresses the given data into the gzip format, returns false on failure */
+bool Compression::compressGzip(Slice input, std::string &outResult)
+{
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+
+    // Adding 16 to the window bits selects the gzip wrapper instead of zlib's
+    if (deflateInit2(&stream, COMPRESSION_LEVEL, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+
+    // The bound is large enough to compress everything in a single call
+    outResult.resize(deflateBound(&stream, input.getLength()));
+    stream.next_in   = reinterpret_cast<Bytef *>(const_cast<char *>(input.isEmpty() ? "" : &input[0]));
+    stream.avail_in  = input.getLength();
+    stream.next_out  = reinterpret_cast<Bytef *>(&outResult[0]);
+    stream.avail_out = outResult.size();
+
+    int result = deflate(&stream, Z_FINISH);
+    size_t length = stream.total_out;
+    deflateEnd(&stream);
+    if (result != Z_STREAM_END)
+        return false;
+    outResult.resize(length);
+    return true;
+}
+
+/* Checks whether the content type (parameters are ignored) is contained in the given set */
+bool Compression::matchesType(const std::set<std::string> &types, Slice contentType)
+{
+    Slice type;
+    if (!contentType.splitStart(';', type))
+        type = contentType;
+    type.stripEnd(' ');
+    return types.find(type.toString()) != types.end();
+}
+
+/* Constructs a task compressing the file at the given path, as long as it matches the given status */
+CompressionTask::CompressionTask(CompressionCache &cache, const std::string &path, const struct stat &status)
+    : _cache(cache), _path(path), _status(status), _isCompressed(false)
+{
+}
+
+/* Reads and compresses the file */
+void CompressionTask::execute()
+{
+    try
+    {
+        // The file is only compressed if it was not changed since it was requested
+        std::ifstream stream(_path.c_str(), std::ios::binary);
+        if (!stream.is_open())
+            return;
+        std::string contents(static_cast<size_t>(_status.st_size), '\0');
+        if (!contents.empty())
+            stream.read(&contents[0], contents.size());
+        if (static_cast<size_t>(stream.gcount()) != contents.size() || stream.peek() != EOF)
+            return;
+        _isCompressed = Compression::compressGzip(Slice(contents), _compressed);
+    }
+    catch (...)
+    {
+        _isCompressed = false;
+    }
+}
+
+/* Stores the compressed file in the cache */
+void CompressionTask::finish()
+{
+    _cache.insert(_path, _status, _compressed, _isCompressed);
+}
+
+/* Constructs an empty compression cache */
+CompressionCache::CompressionCache()
+    : _usedCapacity(0)
+{
+}
+
+/* Releases the cached files, responses still sending them keep their own reference */
+CompressionCache::~CompressionCache()
+{
+    while (!_entries.empty())
+        erase(_entries.begin());
+}
+
+/* Gets a reference to the compressed contents of the file at the given path, which the caller has to release;
+   returns NULL if the file is not compressed yet, in which case it is compressed on the task pool
+   unless it is too large or already being compressed */
+SharedString *CompressionCache::getCompressedFile(const std::string &path, const struct stat &status, TaskPool &taskPool)
+{
+    std::map<std::string, Entry>::iterator entry = _entries.find(path);
+    if (entry != _entries.end())
+    {
+        // The cached contents are only used while the file stays the same
+        if (entry->second.inode == status.st_ino && entry->second.size == status.st_size
+         && entry->second.modificationTime == status.st_mtime)
+        {
+            _usage.splice(_usage.begin(), _usage, entry->second.usage);
+            entry->second.data->acquire();
+            return entry->second.data;
+        }
+        erase(entry);
+    }
+
+    if (status.st_size > COMPRESSION_MAX_FILE_SIZE || _pendingPaths.count(path) != 0)
+        return NULL;
+
+    // Without worker threads the task is finished right away, so the file may already be cached
+    _pendingPaths.insert(path);
+    taskPool.submit(new CompressionTask(*this, path, status));
+    entry = _entries.find(path);
+    if (entry == _entries.end())
+        return NULL;
+    entry->second.data->acquire();
+    return entry->second.data;
+}
+
+/* Stores the compressed contents of a file, or only marks the file as no longer pending on failure */
+void CompressionCache::insert(const std::string &path, const struct stat &status, std::string &compressed, bool isCompressed)
+{
+    _pendingPaths.erase(path);
+    if (!isCompressed || compressed.size() > COMPRESSION_CACHE_CAPACITY)
+        return;
+
+    // A file that changed in the meantime replaces the stale entry
+    std::map<std::string, Entry>::iterator entry = _entries.find(path);
+    if (entry != _entries.end())
+        erase(entry);
+
+    // Make room for the new entry
+    while (!_usage.empty() && _usedCapacity + compressed.size() > COMPRESSION_CACHE_CAPACITY)
+        erase(_entries.find(_usage.back()));
+
+    entry = _entries.insert(std::make_pair(path, Entry())).first;
+    entry->second.inode            = status.st_ino;
+    entry->second.size             = status.st_size;
+    entry->second.modificationTime = status.st_mtime;
+    entry->second.data             = SharedString::create(compressed);
+    entry->second.usage            = _usage.insert(_usage.begin(), path);
+    _usedCapacity += entry->second.data->get().size();
+}
+
+/* Removes the given entry */
+void CompressionCache::erase(std::map<std::string, Entry>::iterator entry)
+{
+    _usedCapacity -= entry->second.data->get().size();
+    entry->second.data->release();
+    _usage.erase(entry->second.usage);
+    _entries.erase(entry);
+}
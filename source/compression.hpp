@@ -0,0 +1,110 @@
+#ifndef COMPRESSION_hpp
+#define COMPRESSION_hpp
+
+#include "slice.hpp"
+#include "task_pool.hpp"
+#include "shared_string.hpp"
+
+#include <set>
+#include <map>
+#include <list>
+#include <string>
+#include <stddef.h>
+#include <sys/stat.h>
+
+/* Total size of the compressed files kept in a compression cache */
+#define COMPRESSION_CACHE_CAPACITY (32 * 1024 * 1024)
+
+/* Largest file that is compressed on the task pool, larger ones are sent uncompressed */
+#define COMPRESSION_MAX_FILE_SIZE (4 * 1024 * 1024)
+
+/* zlib compression level (1-9), higher levels cost a lot more CPU for little gain */
+#define COMPRESSION_LEVEL 6
+
+namespace Compression
+{
+    /* Compresses the given data into the gzip format, returns false on failure */
+    bool compressGzip(Slice input, std::string &outResult);
+
+    /* Checks whether the content type (parameters are ignored) is contained in the given set */
+    bool matchesType(const std::set<std::string> &types, Slice contentType);
+}
+
+class CompressionCache;
+
+/* Reads and compresses a static file on a worker thread and stores the result in the cache */
+class CompressionTask: public Task
+{
+public:
+    /* Constructs a task compressing the file at the given path, as long as it matches the given status */
+    CompressionTask(CompressionCache &cache, const std::string &path, const struct stat &status);
+
+    /* Reads and compresses the file */
+    void execute();
+
+    /* Stores the compressed file in the cache */
+    void finish();
+private:
+    CompressionCache &_cache;
+    std::string       _path;
+    struct stat       _status;
+    std::string       _compressed;
+    bool              _isCompressed;
+};
+
+/* Keeps the gzip-compressed contents of static files, evicting the least recently used ones;
+   files are compressed on the task pool, so the first requests for a file are sent uncompressed */
+class CompressionCache
+{
+public:
+    friend class CompressionTask;
+
+    /* Constructs an empty compression cache */
+    CompressionCache();
+
+    /* Releases the cached files, responses still sending them keep their own reference */
+    ~CompressionCache();
+
+    /* Gets a reference to the compressed contents of the file at the given path, which the caller has to release;
+       returns NULL if the file is not compressed yet, in which case it is compressed on the task pool
+       unless it is too large or already being compressed */
+    SharedString *getCompressedFile(const std::string &path, const struct stat &status, TaskPool &taskPool);
+
+    /* Gets the number of cached files */
+    inline size_t size() const
+    {
+        return _entries.size();
+    }
+
+    /* Gets the total size of the cached files */
+    inline size_t getUsedCapacity() const
+    {
+        return _usedCapacity;
+    }
+private:
+    struct Entry
+    {
+        ino_t                            inode;
+        off_t                            size;
+        time_t                           modificationTime;
+        SharedString                    *data;
+        std::list<std::string>::iterator usage;
+    };
+
+    std::map<std::string, Entry> _entries;
+    std::list<std::string>       _usage;        // Most recently used path first
+    std::set<std::string>        _pendingPaths; // Files which are being compressed
+    size_t                       _usedCapacity;
+
+    /* Stores the compressed contents of a file, or only marks the file as no longer pending on failure */
+    void insert(const std::string &path, const struct stat &status, std::string &compressed, bool isCompressed);
+
+    /* Removes the given entry */
+    void erase(std::map<std::string, Entry>::iterator entry);
+
+    /* Disable copy-construction and copy-assignment */
+    CompressionCache(const CompressionCache &other);
+    CompressionCache &operator=(const CompressionCache &other);
+};
+
+#endif // COMPRESSION_hpp
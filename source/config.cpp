@@ -1,32 +1,70 @@
 #include "config.hpp"
 #include "utility.hpp"
+#include "timeout.hpp"
 
 /* Initializes a server configuration using the default parameters */
 ServerConfig::ServerConfig()
     : maxBodySize(100000)
+    , maxConnections(0)
+    , limitConnections(0)
+    , limitZone(0)
+    , headerTimeout(TIMEOUT_REQUEST_MS)
+    , bodyTimeout(TIMEOUT_BODY_MS)
+    , sendTimeout(TIMEOUT_SEND_MS)
+    , minDataRate(0)
+    , gzipMinLength(256)
+    , headerBufferSize(1024)
+    , largeHeaderBufferCount(0)
+    , largeHeaderBufferSize(8192)
     , nextEndpoint(NULL)
 {
 }
 
+/* Initializes an application configuration using the default parameters */
+ApplicationConfig::ApplicationConfig()
+    : maxConnections(0)
+{
+}
+
 /* Initializes a local route configuration using the default parameters */
 LocalRouteConfig::LocalRouteConfig()
     : allowUpload(false)
     , allowListing(false)
+    , gzipStatic(false)
+    , requestRate(0)
+    , requestBurst(0)
+    , limitZone(0)
+    , rootFileno(-1)
 {
 }
 
-/* Searches for the right server configuration based on the name, returns `this` if not found */
+/* Gets the part of a node path below the root directory, node paths always start with the root directory */
+const char *LocalRouteConfig::getRelativePath(const std::string &nodePath) const
+{
+    if (nodePath.size() <= rootDirectory.size() + 1)
+        return ".";
+    return nodePath.c_str() + rootDirectory.size() + 1;
+}
+
+/* Searches for the right server configuration based on the name (ignoring case), returns `this` if not found */
 const ServerConfig *ServerConfig::findServer(Slice name) const
 {
-    const ServerConfig *head = this;
-    while (head != NULL)
+    const ServerConfig *result = serverNames.find(name);
+    return result != NULL ? result : this;
+}
+
+/* Finds the local route with the longest path prefix of the query path without accessing the
+   file system, returns NULL if there is none */
+const LocalRouteConfig *ServerConfig::findLocation(Slice queryPath) const
+{
+    const LocalRouteConfig *result = NULL;
+    for (size_t index = 0; index < localRoutes.size(); index++)
     {
-        for (size_t index = 0; index < head->name.size(); index++)
-        {
-            if (Slice(head->name[index]) == name)
-                return head;
-        }
-        head = head->nextEndpoint;
+        const LocalRouteConfig &route = localRoutes[index];
+        if (result != NULL && result->path.size() > route.path.size())
+            continue;
+        if (queryPath.startsWith(route.path))
+            result = &route;
     }
-    return this;
+    return result;
 }
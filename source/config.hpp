@@ -3,6 +3,7 @@
 
 #include "http_constants.hpp"
 #include "config_tokenizer.hpp"
+#include "server_name_index.hpp"
 
 #include <map>
 #include <set>
@@ -22,10 +23,18 @@ struct LocalRouteConfig
     std::string                        indexFile;
     bool                               allowUpload;
     bool                               allowListing;
+    bool                               gzipStatic;     // Serve ".br" and ".gz" siblings of static files
     std::map<std::string, std::string> cgiTypes;
+    double                             requestRate;    // Requests per second and client, 0 is unlimited
+    size_t                             requestBurst;
+    uint32_t                           limitZone;      // Assigned by `Application::configure()`
+    int                                rootFileno;     // Opened by `Application::configure()`, -1 if unavailable
     std::set<TokenKind>                parsedTokens;
 
     LocalRouteConfig();
+
+    /* Gets the part of a node path below the root directory, node paths always start with the root directory */
+    const char *getRelativePath(const std::string &nodePath) const;
 };
 
 /* Configuration for a route that immediately redirects the client */
@@ -36,6 +45,13 @@ struct RedirectRouteConfig
     std::string          redirectLocation;
 };
 
+/* Complete error response serialized at startup */
+struct PrerenderedResponse
+{
+    std::string plain;
+    std::string compressed; // Empty unless the server compresses the error page's content type
+};
+
 /* Virtual server configuration */
 struct ServerConfig
 {
@@ -43,22 +59,43 @@ struct ServerConfig
     uint32_t                         host;
     uint16_t                         port;
     std::map<int, std::string>       errorPages;
+    std::map<int, PrerenderedResponse> errorResponses; // Built by `Application::configure()`
     size_t                           maxBodySize;
+    size_t                           maxConnections;  // Applies to the binding, 0 is unlimited
+    size_t                           limitConnections;  // Per client address on the binding, 0 is unlimited
+    uint32_t                         limitZone;       // Assigned by `Application::configure()`
+    uint64_t                         headerTimeout;   // Milliseconds to receive the whole header
+    uint64_t                         bodyTimeout;     // Milliseconds between two body reads
+    uint64_t                         sendTimeout;     // Milliseconds between two response writes
+    size_t                           minDataRate;     // Bytes per second for body and response, 0 is unlimited
+    std::set<std::string>            gzipTypes;       // Content types compressed on the fly, empty disables it
+    size_t                           gzipMinLength;   // Smaller bodies are not worth compressing
+    size_t                           headerBufferSize;       // Applies to the binding, used for every request header
+    size_t                           largeHeaderBufferCount; // Large buffers held at once on the binding, 0 is unlimited
+    size_t                           largeHeaderBufferSize;  // Maximum header length, borrowed once the small buffer overflows
     std::vector<LocalRouteConfig>    localRoutes;
     std::vector<RedirectRouteConfig> redirectRoutes;
     std::set<TokenKind>              parsedTokens;
     ServerConfig                    *nextEndpoint;
+    ServerNameIndex                  serverNames;     // Built by `Application::configure()` on a binding's first server
 
     ServerConfig();
 
-    /* Searches for the right server configuration based on the name, returns `this` if not found */
+    /* Searches for the right server configuration based on the name (ignoring case), returns `this` if not found */
     const ServerConfig *findServer(Slice name) const;
+
+    /* Finds the local route with the longest path prefix of the query path without accessing the
+       file system, returns NULL if there is none */
+    const LocalRouteConfig *findLocation(Slice queryPath) const;
 };
 
 /* Global application configuration; can contain many virtual servers */
 struct ApplicationConfig
 {
     std::vector<ServerConfig> servers;
+    size_t                    maxConnections;  // 0 is unlimited
+
+    ApplicationConfig();
 };
 
 #endif // CONFIG_hpp
@@ -1,4 +1,5 @@
 #include "config_parser.hpp"
+#include "http_request_parser.hpp"
 
 // Constructor
 ConfigParser::ConfigParser(const std::vector<Token> &tokens) : _tokens(tokens), _current(0)
@@ -15,6 +16,14 @@ ApplicationConfig ConfigParser::parse()
             applicationConfig.servers.push_back(parseServerConfig(applicationConfig));
         else if (_tokens[_current].kind == SY_COMMEND)
             moveToNextToken();
+        else if (_tokens[_current].kind == KW_MAX_CONNECTIONS)
+        {
+            if (applicationConfig.maxConnections != 0)
+                throw ConfigException("Error: Redundant token", _config_input, _tokens[_current].offset);
+            moveToNextToken();
+            applicationConfig.maxConnections = parseSizeT();
+            expect(SY_SEMICOLON);
+        }
         else
             throw ConfigException("Error: Unexpected token in config", _config_input, _tokens[_current].offset);
     }    
@@ -56,6 +65,68 @@ ServerConfig ConfigParser::parseServerConfig(ApplicationConfig &applicationConfi
             serverConfig.maxBodySize = parseSizeT();
             expect(SY_SEMICOLON);
             break;
+        case KW_MAX_CONNECTIONS:
+            isRedundantToken(_tokens[_current].offset, serverConfig, KW_MAX_CONNECTIONS, _config_input);
+            moveToNextToken();
+            serverConfig.maxConnections = parseSizeT();
+            expect(SY_SEMICOLON);
+            break;
+        case KW_LIMIT_CONN:
+            isRedundantToken(_tokens[_current].offset, serverConfig, KW_LIMIT_CONN, _config_input);
+            moveToNextToken();
+            serverConfig.limitConnections = parseSizeT();
+            expect(SY_SEMICOLON);
+            break;
+        case KW_CLIENT_HEADER_TIMEOUT:
+            isRedundantToken(_tokens[_current].offset, serverConfig, KW_CLIENT_HEADER_TIMEOUT, _config_input);
+            moveToNextToken();
+            serverConfig.headerTimeout = parseSizeT();
+            expect(SY_SEMICOLON);
+            break;
+        case KW_CLIENT_BODY_TIMEOUT:
+            isRedundantToken(_tokens[_current].offset, serverConfig, KW_CLIENT_BODY_TIMEOUT, _config_input);
+            moveToNextToken();
+            serverConfig.bodyTimeout = parseSizeT();
+            expect(SY_SEMICOLON);
+            break;
+        case KW_SEND_TIMEOUT:
+            isRedundantToken(_tokens[_current].offset, serverConfig, KW_SEND_TIMEOUT, _config_input);
+            moveToNextToken();
+            serverConfig.sendTimeout = parseSizeT();
+            expect(SY_SEMICOLON);
+            break;
+        case KW_MIN_DATA_RATE:
+            isRedundantToken(_tokens[_current].offset, serverConfig, KW_MIN_DATA_RATE, _config_input);
+            moveToNextToken();
+            serverConfig.minDataRate = parseSizeT();
+            expect(SY_SEMICOLON);
+            break;
+        case KW_GZIP_TYPES:
+            isRedundantToken(_tokens[_current].offset, serverConfig, KW_GZIP_TYPES, _config_input);
+            moveToNextToken();
+            serverConfig.gzipTypes = parseGzipTypes();
+            expect(SY_SEMICOLON);
+            break;
+        case KW_GZIP_MIN_LENGTH:
+            isRedundantToken(_tokens[_current].offset, serverConfig, KW_GZIP_MIN_LENGTH, _config_input);
+            moveToNextToken();
+            serverConfig.gzipMinLength = parseSizeT();
+            expect(SY_SEMICOLON);
+            break;
+        case KW_CLIENT_HEADER_BUFFER_SIZE:
+            isRedundantToken(_tokens[_current].offset, serverConfig, KW_CLIENT_HEADER_BUFFER_SIZE, _config_input);
+            moveToNextToken();
+            if ((serverConfig.headerBufferSize = parseSizeT()) < HTTP_REQUEST_BODY_CHUNKED_HEADER_MAX_LENGTH)
+                throw ConfigException("Error: Header buffer size too small", _config_input, _tokens[_current - 1].offset);
+            expect(SY_SEMICOLON);
+            break;
+        case KW_LARGE_CLIENT_HEADER_BUFFERS:
+            isRedundantToken(_tokens[_current].offset, serverConfig, KW_LARGE_CLIENT_HEADER_BUFFERS, _config_input);
+            moveToNextToken();
+            serverConfig.largeHeaderBufferCount = parseSizeT();
+            serverConfig.largeHeaderBufferSize = parseSizeT();
+            expect(SY_SEMICOLON);
+            break;
         case KW_ERROR_PAGE:
             moveToNextToken();
             currentErrorRedirect = parseErrorRedirects();
@@ -143,6 +214,20 @@ std::vector<std::string> ConfigParser::parseServerNames()
     return serverNames;
 }
 
+std::set<std::string> ConfigParser::parseGzipTypes()
+{
+    std::set<std::string> types;
+    while (currentToken().kind != SY_SEMICOLON)
+    {
+        expect(DATA);
+        if (currentToken().data.find('/') == std::string::npos)
+            throw ConfigException("Error: Invalid content type for gzip_types", _config_input, _tokens[_current].offset);
+        types.insert(currentToken().data);
+        moveToNextToken();
+    }
+    return types;
+}
+
 std::string ConfigParser::parseLocalRoutePath()
 {
     expect(DATA);
@@ -255,6 +340,18 @@ LocalRouteConfig ConfigParser::parseLocalRouteConfig(ServerConfig &serverConfig)
             localRouteConfig.allowUpload = parseAllowUpload();
             expect(SY_SEMICOLON);
             break;
+        case KW_GZIP_STATIC:
+            isRedundantToken(_tokens[_current].offset, localRouteConfig, KW_GZIP_STATIC, _config_input);
+            moveToNextToken();
+            localRouteConfig.gzipStatic = parseGzipStatic();
+            expect(SY_SEMICOLON);
+            break;
+        case KW_LIMIT_REQ:
+            isRedundantToken(_tokens[_current].offset, localRouteConfig, KW_LIMIT_REQ, _config_input);
+            moveToNextToken();
+            parseRequestLimit(localRouteConfig);
+            expect(SY_SEMICOLON);
+            break;
         case KW_REDIRECT_ADDRESS:
             isRedundantToken(_tokens[_current].offset, localRouteConfig, KW_REDIRECT_ADDRESS, _config_input);
             isRedundantToken(_tokens[_current].offset, localRouteConfig, KW_ROOT, _config_input);
@@ -331,6 +428,46 @@ bool ConfigParser::parseAllowUpload()
     return allowUpload;
 }
 
+bool ConfigParser::parseGzipStatic()
+{
+    expect(DATA);
+    bool gzipStatic;
+    if (currentToken().data == "on")
+        gzipStatic = true;
+    else if (currentToken().data == "off")
+        gzipStatic = false;
+    else
+        throw ConfigException("Error: Invalid value for gzip_static", _config_input, _tokens[_current].offset);
+    moveToNextToken();
+    return gzipStatic;
+}
+
+// Parses "rate=<n>r/s" or "rate=<n>r/m", optionally followed by "burst=<n>"
+void ConfigParser::parseRequestLimit(LocalRouteConfig &localRouteConfig)
+{
+    expect(DATA);
+    Slice  rate(currentToken().data);
+    Slice  count;
+    size_t number;
+    if (!rate.consumeStart(C_SLICE("rate=")) || !rate.splitStart('r', count) || !Utility::parseSize(count, number)
+        || number == 0)
+        throw ConfigException("Error: Invalid request rate", _config_input, _tokens[_current].offset);
+    if (rate == C_SLICE("/s"))
+        localRouteConfig.requestRate = static_cast<double>(number);
+    else if (rate == C_SLICE("/m"))
+        localRouteConfig.requestRate = static_cast<double>(number) / 60;
+    else
+        throw ConfigException("Error: Invalid request rate unit", _config_input, _tokens[_current].offset);
+    moveToNextToken();
+
+    if (currentToken().kind != DATA)
+        return;
+    Slice burst(currentToken().data);
+    if (!burst.consumeStart(C_SLICE("burst=")) || !Utility::parseSize(burst, localRouteConfig.requestBurst))
+        throw ConfigException("Error: Invalid request burst", _config_input, _tokens[_current].offset);
+    moveToNextToken();
+}
+
 std::map<std::string, std::string> ConfigParser::parseCgiFileExtensions()
 {
     std::map<std::string, std::string> cgiFileExtensions;
@@ -5,6 +5,7 @@
 #include "http_constants.hpp"
 #include "config_tokenizer.hpp"
 #include "config_parser_utility.hpp"
+#include "utility.hpp"
 
 #include <sstream>
 #include <stdint.h>
@@ -29,7 +30,9 @@ private:
                                                  LocalRouteConfig &localRouteConfig);
     bool parseDirectoryListing();
     bool parseAllowUpload();
+    bool parseGzipStatic();
     std::map<std::string, std::string> parseCgiFileExtensions();
+    void parseRequestLimit(LocalRouteConfig &localRouteConfig);
 
     // Parsing RedirectRouteConfig
     RedirectRouteConfig parseRedirectRouteConfig(LocalRouteConfig &localRouteConfig);
@@ -42,6 +45,7 @@ private:
     // Parsing data types
     std::string parseString();
     std::vector<std::string> parseServerNames();
+    std::set<std::string> parseGzipTypes();
     std::string parseLocalRoutePath();
     uint16_t parseUint16();
     size_t parseSizeT();
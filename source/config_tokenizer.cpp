@@ -39,7 +39,8 @@ std::vector<Token> ConfigTokenizer::tokenize()
             offset++;
         }
         else if (std::isalnum(config_input[offset]) || config_input[offset] == '/' ||
-                 config_input[offset] == '.' || config_input[offset] == '_')
+                 config_input[offset] == '.' || config_input[offset] == '_' ||
+                 config_input[offset] == '*')
             tokens.push_back(parseKeywordOrData());
         else if (config_input[offset] == '#')
             tokens.push_back(parseComment());
@@ -106,6 +107,30 @@ TokenKind ConfigTokenizer::getTokenKind(const std::string &word)
         return (KW_CGI);
     else if (word == "allow_upload")
         return (KW_ALLOW_UPLOAD);
+    else if (word == "max_connections")
+        return (KW_MAX_CONNECTIONS);
+    else if (word == "limit_conn")
+        return (KW_LIMIT_CONN);
+    else if (word == "limit_req")
+        return (KW_LIMIT_REQ);
+    else if (word == "client_header_timeout")
+        return (KW_CLIENT_HEADER_TIMEOUT);
+    else if (word == "client_body_timeout")
+        return (KW_CLIENT_BODY_TIMEOUT);
+    else if (word == "send_timeout")
+        return (KW_SEND_TIMEOUT);
+    else if (word == "min_data_rate")
+        return (KW_MIN_DATA_RATE);
+    else if (word == "gzip_static")
+        return (KW_GZIP_STATIC);
+    else if (word == "gzip_types")
+        return (KW_GZIP_TYPES);
+    else if (word == "gzip_min_length")
+        return (KW_GZIP_MIN_LENGTH);
+    else if (word == "client_header_buffer_size")
+        return (KW_CLIENT_HEADER_BUFFER_SIZE);
+    else if (word == "large_client_header_buffers")
+        return (KW_LARGE_CLIENT_HEADER_BUFFERS);
     else if (word == "#")
         return (SY_COMMEND);
     else
@@ -156,6 +181,30 @@ std::string ConfigTokenizer::TokenKindToString(TokenKind token)
         return "KW_CGI";
     case KW_ALLOW_UPLOAD:
         return "KW_ALLOW_UPLOAD";
+    case KW_MAX_CONNECTIONS:
+        return "KW_MAX_CONNECTIONS";
+    case KW_LIMIT_CONN:
+        return "KW_LIMIT_CONN";
+    case KW_LIMIT_REQ:
+        return "KW_LIMIT_REQ";
+    case KW_CLIENT_HEADER_TIMEOUT:
+        return "KW_CLIENT_HEADER_TIMEOUT";
+    case KW_CLIENT_BODY_TIMEOUT:
+        return "KW_CLIENT_BODY_TIMEOUT";
+    case KW_SEND_TIMEOUT:
+        return "KW_SEND_TIMEOUT";
+    case KW_MIN_DATA_RATE:
+        return "KW_MIN_DATA_RATE";
+    case KW_GZIP_STATIC:
+        return "KW_GZIP_STATIC";
+    case KW_GZIP_TYPES:
+        return "KW_GZIP_TYPES";
+    case KW_GZIP_MIN_LENGTH:
+        return "KW_GZIP_MIN_LENGTH";
+    case KW_CLIENT_HEADER_BUFFER_SIZE:
+        return "KW_CLIENT_HEADER_BUFFER_SIZE";
+    case KW_LARGE_CLIENT_HEADER_BUFFERS:
+        return "KW_LARGE_CLIENT_HEADER_BUFFERS";
     case SY_BRACE_OPEN:
         return "SY_BRACE_OPEN";
     case SY_BRACE_CLOSE:
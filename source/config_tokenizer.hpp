@@ -23,6 +23,18 @@ enum TokenKind
     KW_MAX_BODY_SIZE,
     KW_CGI,
     KW_ALLOW_UPLOAD,
+    KW_MAX_CONNECTIONS,
+    KW_LIMIT_CONN,
+    KW_LIMIT_REQ,
+    KW_CLIENT_HEADER_TIMEOUT,
+    KW_CLIENT_BODY_TIMEOUT,
+    KW_SEND_TIMEOUT,
+    KW_MIN_DATA_RATE,
+    KW_GZIP_STATIC,
+    KW_GZIP_TYPES,
+    KW_GZIP_MIN_LENGTH,
+    KW_CLIENT_HEADER_BUFFER_SIZE,
+    KW_LARGE_CLIENT_HEADER_BUFFERS,
     SY_BRACE_OPEN,
     SY_BRACE_CLOSE,
     SY_SEMICOLON,
@@ -108,6 +108,7 @@ static void printAllowedMethods(const std::set<HttpMethod> &methods)
 /* Prints the given configuration to standard output */
 void Debug::printConfig(const ApplicationConfig &config)
 {
+    std::cout << "Maximum connections: " << config.maxConnections << std::endl;
     for (size_t index = 0; index < config.servers.size(); index++)
     {
         const ServerConfig &serverConfig = config.servers[index];
@@ -116,6 +117,18 @@ void Debug::printConfig(const ApplicationConfig &config)
         printStringVector("+ Server names: ", serverConfig.name);
         printAddressField("  Bind address: ", serverConfig.host, serverConfig.port);
         std::cout << "  Maximum allowed body size: " << serverConfig.maxBodySize << std::endl;
+        std::cout << "  Maximum connections: " << serverConfig.maxConnections << std::endl;
+        std::cout << "  Maximum connections per client: " << serverConfig.limitConnections << std::endl;
+        std::cout << "  Timeouts: " << serverConfig.headerTimeout << " ms for the header, "
+                  << serverConfig.bodyTimeout << " ms between body reads, "
+                  << serverConfig.sendTimeout << " ms between response writes" << std::endl;
+        std::cout << "  Minimum data rate: " << serverConfig.minDataRate << " B/s" << std::endl;
+        printStringVector("  Compressed types: ",
+            std::vector<std::string>(serverConfig.gzipTypes.begin(), serverConfig.gzipTypes.end()));
+        std::cout << "  Minimum compressed length: " << serverConfig.gzipMinLength << std::endl;
+        std::cout << "  Header buffers: " << serverConfig.headerBufferSize << " B, "
+                  << serverConfig.largeHeaderBufferCount << " large of " << serverConfig.largeHeaderBufferSize
+                  << " B" << std::endl;
 
         // Print error pages
         std::map<int, std::string>::const_iterator errorPage = serverConfig.errorPages.begin();
@@ -137,6 +150,9 @@ void Debug::printConfig(const ApplicationConfig &config)
             printStringField("    Upload directory: ", routeConfig.uploadDirectory);
             printBoolField("    Uploads allowed?: ", routeConfig.allowUpload);
             printBoolField("    Listing allowed?: ", routeConfig.allowListing);
+            printBoolField("    Precompressed files?: ", routeConfig.gzipStatic);
+            std::cout << "    Request rate per client: " << routeConfig.requestRate
+                      << "/s (burst " << routeConfig.requestBurst << ')' << std::endl;
 
             // Print CGI types
             std::map<std::string, std::string>::const_iterator cgiType = routeConfig.cgiTypes.begin();
@@ -169,7 +185,7 @@ void Debug::printRequest(const HttpRequest &request)
     printStringField("  Query path: ", request.queryPath);
     printStringField("  Query parameters: ", request.queryParameters);
     printBoolField("  Is legacy?: ", request.isLegacy);
-    for (size_t index = 0; index < request.headers.size(); index++)
+    for (size_t index = 0; index < request.headerCount; index++)
     {
         std::cout << "    Header ";
         printString(request.headers[index].getKey());
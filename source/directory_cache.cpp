@@ -0,0 +1,225 @@
+#include "directory_cache.hpp"
+
+#include <cctype>
+#include <dirent.h>
+#include <strings.h>
+#include <algorithm>
+#include <stdexcept>
+
+/* RAII wrapper around `opendir()` and `closedir()` */
+class DirectoryHandle
+{
+public:
+    /* Opens a directory pointer */
+    inline DirectoryHandle(const char *path)
+    {
+        if ((_pointer = opendir(path)) == NULL)
+            throw std::runtime_error("Unable to open directory");
+    }
+
+    /* Releases the directory pointer */
+    inline ~DirectoryHandle()
+    {
+        if (_pointer)
+            closedir(_pointer);
+    }
+
+    /* Gets the next file name */
+    inline dirent *next()
+    {
+        return readdir(_pointer);
+    }
+private:
+    DIR *_pointer;
+
+    /* Prevent construction by copy */
+    DirectoryHandle(const DirectoryHandle &other);
+
+    /* Prevent assignment by copy */
+    DirectoryHandle &operator=(const DirectoryHandle &other);
+};
+
+/* Comparison function for `std::sort()` */
+static bool compareLowercase(const std::string &lhs, const std::string &rhs)
+{
+#ifdef __42_LIKES_WASTING_CPU_CYCLES__
+    const char *lhsPointer = lhs.c_str();
+    const char *rhsPointer = rhs.c_str();
+
+    while (*lhsPointer && *rhsPointer)
+    {
+        int lhsCharacter = std::tolower(*lhsPointer);
+        int rhsCharacter = std::tolower(*rhsPointer);
+        if (lhsCharacter != rhsCharacter)
+            return (lhsCharacter - rhsCharacter) < 0;
+        lhsPointer++;
+        rhsPointer++;
+    }
+    return (std::tolower(*lhsPointer) - std::tolower(*rhsPointer)) < 0;
+#else
+    return strcasecmp(lhs.c_str(), rhs.c_str()) < 0;
+#endif // __42_LIKES_WASTING_CPU_CYCLES__
+}
+
+/* Constructs an empty directory cache */
+DirectoryCache::DirectoryCache()
+    : _usedCapacity(0)
+{
+}
+
+/* Releases the cached pages, responses still sending them keep their own reference */
+DirectoryCache::~DirectoryCache()
+{
+    while (!_entries.empty())
+        erase(_entries.begin());
+}
+
+/* Gets a reference to the listing page (starting at 1) of the directory at the given path, which the caller
+   has to release; the directory is only read again if it was modified or the page needs its dropped entries;
+   returns NULL if the page does not exist */
+SharedString *DirectoryCache::getPage(const std::string &path, const struct stat &status, size_t page)
+{
+    Entry &entry = findEntry(path, status, page)->second;
+
+    size_t pageCount = (entry.nameCount + DIRECTORY_LIST_PAGE_SIZE - 1) / DIRECTORY_LIST_PAGE_SIZE;
+    if (page == 0 || (page > pageCount && page != 1))
+        return NULL;
+
+    // Only the first page is kept, it is by far the most requested one
+    SharedString *result;
+    if (page == 1)
+    {
+        if (entry.page == NULL)
+        {
+            std::string rendered = HtmlGenerator::directoryList(entry.names, 1);
+            entry.page = SharedString::create(rendered);
+            resize(entry, entry.capacity + entry.page->get().size());
+        }
+        result = entry.page;
+        result->acquire();
+    }
+    else
+    {
+        std::string rendered = HtmlGenerator::directoryList(entry.names, page);
+        result = SharedString::create(rendered);
+    }
+
+    if (entry.capacity > DIRECTORY_CACHE_CAPACITY)
+        trim(entry);
+    return result;
+}
+
+/* Gets the inode and modification time of the cached directory at the given path; returns false if
+   the directory is not cached or the given page can not be rendered without reading it again */
+bool DirectoryCache::findVersion(const std::string &path, size_t page, ino_t &outInode, timespec &outModificationTime) const
+{
+    std::map<std::string, Entry>::const_iterator iterator = _entries.find(path);
+    if (iterator == _entries.end() || !iterator->second.hasPage(page))
+        return false;
+    outInode = iterator->second.inode;
+    outModificationTime = iterator->second.modificationTime;
+    return true;
+}
+
+/* Caches the entries of the directory at the given path, which are taken from `names` */
+void DirectoryCache::insert(const std::string &path, const struct stat &status, std::vector<std::string> &names)
+{
+    insertEntry(path, status, names);
+}
+
+/* Reads and sorts the entries of the directory at the given path; the cache is not touched,
+   so it may be used on any thread */
+void DirectoryCache::readNames(const std::string &path, std::vector<std::string> &outNames)
+{
+    DirectoryHandle handle(path.c_str());
+    dirent         *directoryEntry;
+    while ((directoryEntry = handle.next()) != NULL)
+        outNames.push_back(directoryEntry->d_name);
+    std::sort(outNames.begin(), outNames.end(), compareLowercase);
+}
+
+/* Gets the up-to-date entry of the directory at the given path, which can render the given page */
+std::map<std::string, DirectoryCache::Entry>::iterator DirectoryCache::findEntry(const std::string &path,
+    const struct stat &status, size_t page)
+{
+    std::map<std::string, Entry>::iterator iterator = _entries.find(path);
+    if (iterator != _entries.end())
+    {
+        // Any change to the entries updates the modification time of the directory
+        Entry &entry = iterator->second;
+        if (entry.inode == status.st_ino && entry.modificationTime.tv_sec == status.st_mtim.tv_sec
+         && entry.modificationTime.tv_nsec == status.st_mtim.tv_nsec && entry.hasPage(page))
+        {
+            _usage.splice(_usage.begin(), _usage, entry.usage);
+            return iterator;
+        }
+    }
+
+    // Read and sort the entries before anything is replaced, reading may fail
+    std::vector<std::string> names;
+    readNames(path, names);
+    return insertEntry(path, status, names);
+}
+
+/* Replaces the entry of the directory at the given path, the entries are taken from `names` */
+std::map<std::string, DirectoryCache::Entry>::iterator DirectoryCache::insertEntry(const std::string &path,
+    const struct stat &status, std::vector<std::string> &names)
+{
+    std::map<std::string, Entry>::iterator iterator = _entries.find(path);
+    if (iterator != _entries.end())
+        erase(iterator);
+
+    size_t capacity = path.size();
+    for (size_t index = 0; index < names.size(); index++)
+        capacity += names[index].size() + sizeof(std::string);
+
+    iterator = _entries.insert(std::make_pair(path, Entry())).first;
+    Entry &entry = iterator->second;
+    entry.inode            = status.st_ino;
+    entry.modificationTime = status.st_mtim;
+    entry.names.swap(names);
+    entry.nameCount        = entry.names.size();
+    entry.hasNames         = true;
+    entry.page             = NULL;
+    entry.capacity         = 0;
+    entry.usage            = _usage.insert(_usage.begin(), path);
+    resize(entry, capacity);
+    return iterator;
+}
+
+/* Accounts for a change of the entry's size and evicts other entries if the capacity is exceeded */
+void DirectoryCache::resize(Entry &entry, size_t capacity)
+{
+    _usedCapacity += capacity - entry.capacity;
+    entry.capacity = capacity;
+
+    // The given entry is the most recently used one, so it is evicted last; an entry exceeding the whole
+    // capacity is trimmed by `getPage()` instead of evicting everything else
+    while (_usedCapacity > DIRECTORY_CACHE_CAPACITY && entry.capacity <= DIRECTORY_CACHE_CAPACITY
+        && _usage.back() != _usage.front())
+        erase(_entries.find(_usage.back()));
+}
+
+/* Drops the names of an entry that exceeds the cache's capacity, keeping its rendered first page */
+void DirectoryCache::trim(Entry &entry)
+{
+    // The first page and out-of-range pages are still served from the cache, other pages read the directory
+    if (entry.page == NULL)
+    {
+        std::string rendered = HtmlGenerator::directoryList(entry.names, 1);
+        entry.page = SharedString::create(rendered);
+    }
+    std::vector<std::string>().swap(entry.names);
+    entry.hasNames = false;
+    resize(entry, entry.usage->size() + entry.page->get().size());
+}
+
+/* Removes the given entry */
+void DirectoryCache::erase(std::map<std::string, Entry>::iterator entry)
+{
+    _usedCapacity -= entry->second.capacity;
+    if (entry->second.page != NULL)
+        entry->second.page->release();
+    _usage.erase(entry->second.usage);
+    _entries.erase(entry);
+}
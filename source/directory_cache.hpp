@@ -0,0 +1,99 @@
+#ifndef DIRECTORY_CACHE_hpp
+#define DIRECTORY_CACHE_hpp
+
+#include "html_generator.hpp"
+#include "shared_string.hpp"
+
+#include <map>
+#include <list>
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <sys/stat.h>
+
+/* Total size of the entry names and rendered pages kept in a directory cache */
+#define DIRECTORY_CACHE_CAPACITY (16 * 1024 * 1024)
+
+/* Keeps the sorted entries and the rendered listing page of directories, evicting the least recently used ones;
+   directories too large for the cache only keep their first page and their number of entries */
+class DirectoryCache
+{
+public:
+    /* Constructs an empty directory cache */
+    DirectoryCache();
+
+    /* Releases the cached pages, responses still sending them keep their own reference */
+    ~DirectoryCache();
+
+    /* Gets a reference to the listing page (starting at 1) of the directory at the given path, which the caller
+       has to release; the directory is only read again if it was modified or the page needs its dropped entries;
+       returns NULL if the page does not exist */
+    SharedString *getPage(const std::string &path, const struct stat &status, size_t page);
+
+    /* Gets the inode and modification time of the cached directory at the given path; returns false if
+       the directory is not cached or the given page can not be rendered without reading it again */
+    bool findVersion(const std::string &path, size_t page, ino_t &outInode, timespec &outModificationTime) const;
+
+    /* Caches the entries of the directory at the given path, which are taken from `names` */
+    void insert(const std::string &path, const struct stat &status, std::vector<std::string> &names);
+
+    /* Reads and sorts the entries of the directory at the given path; the cache is not touched,
+       so it may be used on any thread */
+    static void readNames(const std::string &path, std::vector<std::string> &outNames);
+
+    /* Gets the number of cached directories */
+    inline size_t size() const
+    {
+        return _entries.size();
+    }
+
+    /* Gets the total size of the cached directories */
+    inline size_t getUsedCapacity() const
+    {
+        return _usedCapacity;
+    }
+private:
+    struct Entry
+    {
+        ino_t                            inode;
+        timespec                         modificationTime;
+        std::vector<std::string>         names;
+        size_t                           nameCount;
+        bool                             hasNames;  // Cleared once the names of a large directory are dropped
+        SharedString                    *page;      // Rendered first page, NULL until requested
+        size_t                           capacity;  // Bytes accounted for in `_usedCapacity`
+        std::list<std::string>::iterator usage;
+
+        /* Checks whether the given page (starting at 1) can be rendered from the entry */
+        inline bool hasPage(size_t page) const
+        {
+            return hasNames || page == 1 || page > (nameCount + DIRECTORY_LIST_PAGE_SIZE - 1) / DIRECTORY_LIST_PAGE_SIZE;
+        }
+    };
+
+    std::map<std::string, Entry> _entries;
+    std::list<std::string>       _usage; // Most recently used path first
+    size_t                       _usedCapacity;
+
+    /* Gets the up-to-date entry of the directory at the given path, which can render the given page */
+    std::map<std::string, Entry>::iterator findEntry(const std::string &path, const struct stat &status, size_t page);
+
+    /* Replaces the entry of the directory at the given path, the entries are taken from `names` */
+    std::map<std::string, Entry>::iterator insertEntry(const std::string &path, const struct stat &status,
+                                                       std::vector<std::string> &names);
+
+    /* Accounts for a change of the entry's size and evicts other entries if the capacity is exceeded */
+    void resize(Entry &entry, size_t capacity);
+
+    /* Drops the names of an entry that exceeds the cache's capacity, keeping its rendered first page */
+    void trim(Entry &entry);
+
+    /* Removes the given entry */
+    void erase(std::map<std::string, Entry>::iterator entry);
+
+    /* Disable copy-construction and copy-assignment */
+    DirectoryCache(const DirectoryCache &other);
+    DirectoryCache &operator=(const DirectoryCache &other);
+};
+
+#endif // DIRECTORY_CACHE_hpp
@@ -1,6 +1,8 @@
 #include "dispatcher.hpp"
 #include "signal_manager.hpp"
+#include "timeout.hpp"
 
+#include <errno.h>
 #include <unistd.h>
 #include <stdexcept>
 
@@ -99,8 +101,14 @@ void Dispatcher::dispatch(int timeout)
     _buffer.resize(_bufferSize);
 
     int count = epoll_wait(_epollFileno, _buffer.data(), _bufferSize, timeout);
+
+    // Everything handled until the next wait shares the time at which the loop woke up
+    Timeout::updateCurrentTime();
     if (SignalManager::shouldQuit())
         return;
+    // Other signals (eg. a binary upgrade request) interrupt the wait without being an error
+    if (count < 0 && errno == EINTR)
+        return;
     if (count < 0)
         throw std::runtime_error("Unable to wait for events to occur");
 
@@ -12,6 +12,12 @@ public:
 
     /* Gets the error message for the error number specified */
     const std::string &getErrorType(int code);
+
+    /* Gets all known status codes and their messages */
+    inline const std::map<int, std::string> &getEntries() const
+    {
+        return _entries;
+    }
 private:
     std::map<int, std::string>         _entries;
     std::string                        _defaultError;
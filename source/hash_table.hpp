@@ -0,0 +1,210 @@
+#ifndef HASH_TABLE_hpp
+#define HASH_TABLE_hpp
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Default hashing and comparison for integer keys */
+template <typename Key>
+struct HashTraits
+{
+    /* Mixes the key's bits so that sequential keys (eg. IPv4 addresses) spread over the table */
+    static inline uint64_t hash(Key key)
+    {
+        uint64_t value = static_cast<uint64_t>(key);
+        value ^= value >> 33;
+        value *= 0xff51afd7ed558ccdull;
+        value ^= value >> 33;
+        value *= 0xc4ceb9fe1a85ec53ull;
+        value ^= value >> 33;
+        return value;
+    }
+
+    /* Compares two keys for equality */
+    static inline bool equals(Key lhs, Key rhs)
+    {
+        return lhs == rhs;
+    }
+};
+
+/* Open-addressing hash table with linear probing; lookups, insertions and removals are O(1) on average */
+template <typename Key, typename Value, typename Traits = HashTraits<Key> >
+class HashTable
+{
+public:
+    /* Constructs an empty hash table */
+    HashTable()
+        : _size(0)
+    {
+    }
+
+    /* Gets the number of stored entries */
+    inline size_t size() const
+    {
+        return _size;
+    }
+
+    /* Gets the number of slots */
+    inline size_t capacity() const
+    {
+        return _slots.size();
+    }
+
+    /* Finds the value stored for the given key, returns NULL if there is none */
+    const Value *find(const Key &key) const
+    {
+        if (_size == 0)
+            return NULL;
+        size_t mask = _slots.size() - 1;
+        for (size_t index = Traits::hash(key) & mask; _slots[index].isUsed; index = (index + 1) & mask)
+        {
+            if (Traits::equals(_slots[index].key, key))
+                return &_slots[index].value;
+        }
+        return NULL;
+    }
+
+    /* Finds the value stored for the given key, returns NULL if there is none */
+    Value *find(const Key &key)
+    {
+        return const_cast<Value *>(static_cast<const HashTable *>(this)->find(key));
+    }
+
+    /* Finds the value stored for the given key, inserting `initial` if there is none */
+    Value &findOrInsert(const Key &key, const Value &initial)
+    {
+        Value *value = find(key);
+        if (value != NULL)
+            return *value;
+
+        // Keep the load factor below 3/4 so that probe sequences stay short
+        if ((_size + 1) * 4 > _slots.size() * 3)
+            grow();
+        size_t index = findFreeSlot(key);
+        _slots[index].key = key;
+        _slots[index].value = initial;
+        _slots[index].isUsed = true;
+        _size++;
+        return _slots[index].value;
+    }
+
+    /* Removes the entry stored for the given key, returns whether there was one */
+    bool erase(const Key &key)
+    {
+        if (_size == 0)
+            return false;
+        size_t mask = _slots.size() - 1;
+        for (size_t index = Traits::hash(key) & mask; _slots[index].isUsed; index = (index + 1) & mask)
+        {
+            if (Traits::equals(_slots[index].key, key))
+            {
+                eraseSlot(index);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /* Halves the number of slots while fewer than an eighth of them are used, so that a table filled
+       by a burst of keys gives its memory back once they are removed */
+    void shrink()
+    {
+        size_t slotCount = _slots.size();
+        while (slotCount > 16 && _size * 8 < slotCount)
+            slotCount /= 2;
+        if (slotCount != _slots.size())
+            rehash(slotCount);
+    }
+
+    /* Visits up to `count` slots starting at `cursor` and removes the entries for which
+       `shouldRemove(key, value)` returns true; the cursor is advanced for the next call */
+    template <typename Predicate>
+    void sweep(size_t &cursor, size_t count, Predicate shouldRemove)
+    {
+        if (_slots.empty())
+            return;
+        size_t mask = _slots.size() - 1;
+        if (count > _slots.size())
+            count = _slots.size();
+        for (size_t step = 0; step < count; step++)
+        {
+            cursor &= mask;
+            // A removal shifts the following entries back, so the same slot is visited again
+            while (_slots[cursor].isUsed && shouldRemove(_slots[cursor].key, _slots[cursor].value))
+                eraseSlot(cursor);
+            cursor++;
+        }
+    }
+private:
+    struct Slot
+    {
+        Key   key;
+        Value value;
+        bool  isUsed;
+
+        Slot()
+            : key()
+            , value()
+            , isUsed(false)
+        {
+        }
+    };
+
+    std::vector<Slot> _slots;
+    size_t            _size;
+
+    /* Finds the slot at which the given (absent) key would be inserted */
+    size_t findFreeSlot(const Key &key)
+    {
+        size_t mask = _slots.size() - 1;
+        size_t index = Traits::hash(key) & mask;
+        while (_slots[index].isUsed)
+            index = (index + 1) & mask;
+        return index;
+    }
+
+    /* Doubles the number of slots and reinserts all entries */
+    void grow()
+    {
+        rehash(_slots.empty() ? 16 : _slots.size() * 2);
+    }
+
+    /* Moves all entries into the given number of slots, which is a power of two */
+    void rehash(size_t slotCount)
+    {
+        std::vector<Slot> oldSlots(slotCount);
+        oldSlots.swap(_slots);
+        for (size_t index = 0; index < oldSlots.size(); index++)
+        {
+            if (oldSlots[index].isUsed)
+                _slots[findFreeSlot(oldSlots[index].key)] = oldSlots[index];
+        }
+    }
+
+    /* Empties a slot and shifts back the following entries of the probe sequence,
+       so that no tombstones are required */
+    void eraseSlot(size_t index)
+    {
+        size_t mask = _slots.size() - 1;
+        size_t next = index;
+        while (true)
+        {
+            next = (next + 1) & mask;
+            if (!_slots[next].isUsed)
+                break;
+
+            // Move the entry back unless its home slot lies cyclically in (index, next]
+            size_t home = Traits::hash(_slots[next].key) & mask;
+            bool   isInRange = (index <= next) ? (index < home && home <= next) : (index < home || home <= next);
+            if (isInRange)
+                continue;
+            _slots[index] = _slots[next];
+            index = next;
+        }
+        _slots[index] = Slot();
+        _size--;
+    }
+};
+
+#endif // HASH_TABLE_hpp
@@ -3,65 +3,8 @@
 #include "utility.hpp"
 #include "error_db.hpp"
 
-#include <dirent.h>
-#include <strings.h>
 #include <algorithm>
 
-/* RAII wrapper around `opendir()` and `closedir()` */
-class DirectoryHandle
-{
-public:
-    /* Opens a directory pointer */
-    inline DirectoryHandle(const char *path)
-    {
-        if ((_pointer = opendir(path)) == NULL)
-            throw std::runtime_error("Unable to open directory");
-    }
-
-    /* Releases the directory pointer */
-    inline ~DirectoryHandle()
-    {
-        if (_pointer)
-            closedir(_pointer);
-    }
-
-    /* Gets the next file name */
-    inline dirent *next()
-    {
-        return readdir(_pointer);
-    }
-private:
-    DIR *_pointer;
-
-    /* Prevent construction by copy */
-    DirectoryHandle(const DirectoryHandle &other);
-
-    /* Prevent assignment by copy */
-    DirectoryHandle &operator=(const DirectoryHandle &other);
-};
-
-/* Comparison function for `std::sort()` */
-static bool compareLowercase(const std::string &lhs, const std::string &rhs)
-{
-#ifdef __42_LIKES_WASTING_CPU_CYCLES__
-    const char *lhsPointer = lhs.c_str();
-    const char *rhsPointer = rhs.c_str();
-
-    while (*lhsPointer && *rhsPointer)
-    {
-        int lhsCharacter = std::tolower(*lhsPointer);
-        int rhsCharacter = std::tolower(*rhsPointer);
-        if (lhsCharacter != rhsCharacter)
-            return (lhsCharacter - rhsCharacter) < 0;
-        lhsPointer++;
-        rhsPointer++;
-    }
-    return (std::tolower(*lhsPointer) - std::tolower(*rhsPointer)) < 0;
-#else
-    return strcasecmp(lhs.c_str(), rhs.c_str()) < 0;
-#endif // __42_LIKES_WASTING_CPU_CYCLES__
-}
-
 /* Generates an error page for the given status code */
 std::string HtmlGenerator::errorPage(int statusCode)
 {
@@ -85,44 +28,64 @@ std::string HtmlGenerator::errorPage(int statusCode)
     return stream.str();
 }
 
-/* Generates a directory list page for the given directory */
-std::string HtmlGenerator::directoryList(const char *path)
+/* Generates a directory list page showing the given page (starting at 1) of the sorted entry names */
+std::string HtmlGenerator::directoryList(const std::vector<std::string> &names, size_t page)
 {
-    dirent                  *entry;
-    std::vector<std::string> files;
-    std::stringstream        stream;
-    DirectoryHandle          handle(path);
-
-    stream << "<!DOCTYPE html>\n"
-              "<html lang=\"en\">\n"
-              "<head>\n"
-              "    <meta charset=\"UTF-8\">\n"
-              "    <meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n"
-              "    <title>Directory listing</title>\n"
-              "    <style>\n"
-              "        body {\n"
-              "            font-family: Arial, sans-serif;\n"
-              "        }\n"
-              "    </style>\n"
-              "</head>\n"
-              "<body>\n"
-              "<h1>Directory listing</h1>\n"
-              "<hr>\n"
-              "<ul>";
-
-    while ((entry = handle.next()) != NULL)
-        files.push_back(entry->d_name);
-
-    std::sort(files.begin(), files.end(), compareLowercase);
-
-    std::vector<std::string>::iterator iterator = files.begin();
-    for (; iterator != files.end(); iterator++)
-        stream << "<li><a href=\"" << *iterator << "\">" << *iterator << "</a></li>\n";
+    static const char header[] =
+        "<!DOCTYPE html>\n"
+        "<html lang=\"en\">\n"
+        "<head>\n"
+        "    <meta charset=\"UTF-8\">\n"
+        "    <meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n"
+        "    <title>Directory listing</title>\n"
+        "    <style>\n"
+        "        body {\n"
+        "            font-family: Arial, sans-serif;\n"
+        "        }\n"
+        "    </style>\n"
+        "</head>\n"
+        "<body>\n"
+        "<h1>Directory listing</h1>\n"
+        "<hr>\n"
+        "<ul>";
+    static const char footer[] =
+        "\n"
+        "</body>\n"
+        "</html>\n";
+
+    size_t pageCount = (names.size() + DIRECTORY_LIST_PAGE_SIZE - 1) / DIRECTORY_LIST_PAGE_SIZE;
+    size_t first = (page - 1) * DIRECTORY_LIST_PAGE_SIZE;
+    size_t last = std::min(first + DIRECTORY_LIST_PAGE_SIZE, names.size());
+
+    // Reserve the final size up front, every name appears twice per line
+    size_t length = sizeof(header) + sizeof(footer) + 128;
+    for (size_t index = first; index < last; index++)
+        length += names[index].size() * 2 + 30;
+    std::string result;
+    result.reserve(length);
+
+    result.append(header, sizeof(header) - 1);
+    for (size_t index = first; index < last; index++)
+    {
+        result.append("<li><a href=\"");
+        result.append(names[index]);
+        result.append("\">");
+        result.append(names[index]);
+        result.append("</a></li>\n");
+    }
+    result.append("</ul>\n");
 
-    stream << "</ul>\n"
-              "\n"
-              "</body>\n"
-              "</html>\n";
+    // Link the neighbouring pages of large directories
+    if (pageCount > 1)
+    {
+        result.append("<p>Page " + Utility::numberToString(page) + " of " + Utility::numberToString(pageCount));
+        if (page > 1)
+            result.append(" <a href=\"?page=" + Utility::numberToString(page - 1) + "\">previous</a>");
+        if (page < pageCount)
+            result.append(" <a href=\"?page=" + Utility::numberToString(page + 1) + "\">next</a>");
+        result.append("</p>\n");
+    }
 
-    return stream.str();
+    result.append(footer, sizeof(footer) - 1);
+    return result;
 }
@@ -2,14 +2,19 @@
 #define HTML_GENERATOR_hpp
 
 #include <string>
+#include <vector>
+#include <stddef.h>
+
+/* Number of entries shown per directory listing page */
+#define DIRECTORY_LIST_PAGE_SIZE 1000
 
 namespace HtmlGenerator
 {
     /* Generates an error page for the given status code */
     std::string errorPage(int statusCode);
 
-    /* Generates a directory list page for the given directory */
-    std::string directoryList(const char *path);
+    /* Generates a directory list page showing the given page (starting at 1) of the sorted entry names */
+    std::string directoryList(const std::vector<std::string> &names, size_t page);
 };
 
 #endif // HTML_GENERATOR_hpp
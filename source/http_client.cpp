@@ -11,23 +11,33 @@
 #include "signal_manager.hpp"
 
 #include <stdio.h>
+#include <cstring>
 #include <unistd.h>
 #include <algorithm>
 #include <sys/stat.h>
+#include <sys/socket.h>
 #include <fcntl.h>
 
-/* Constructs a HTTP client using the given socket file descriptor */
-HttpClient::HttpClient(Application &application, const ServerConfig *config, int fileno, uint32_t host, uint16_t port)
+/* Constructs a HTTP client of the given server using the given socket file descriptor */
+HttpClient::HttpClient(Application &application, HttpServer &server, int fileno, uint32_t host, uint16_t port)
     : _application(application)
-    , _config(config)
+    , _config(&server.getConfig())
+    , _server(&server)
     , _fileno(fileno)
-    , _timeout(TIMEOUT_REQUEST_MS)
+    , _timeout(server.getConfig().headerTimeout)
     , _waitingForClose(false)
     , _markedForCleanup(false)
+    , _hasConnectionSlot(false)
     , _process(NULL)
+    , _task(NULL)
     , _host(host)
     , _port(port)
-    , _parser(*config, host, port)
+    , _arena(application._bufferPool)
+    , _parser(server.getConfig(), host, port, server.getHeaderPool(), server.getLargeHeaderPool(), _arena)
+    , _response(application._bufferPool)
+    , _phaseStartTime(Timeout::getCurrentTime())
+    , _phaseBytes(0)
+    , _isRateChecked(false)
 {
 }
 
@@ -35,7 +45,9 @@ HttpClient::HttpClient(Application &application, const ServerConfig *config, int
 HttpClient::~HttpClient()
 {
     if (_process != NULL)
-        delete _process;
+        _application.closeCgiProcess(this);
+    if (_task != NULL)
+        _task->client = NULL;
     close(_fileno);
 }
 
@@ -70,9 +82,23 @@ void HttpClient::handleEvents(uint32_t eventMask)
             throw std::runtime_error("End of stream");
 
         Slice data(buffer, length);
+        HttpRequestPhase previousPhase = _parser.getPhase();
         try
         {
-            if (_parser.commit(data))
+            bool isFinal = _parser.commit(data);
+
+            // The header must arrive within a fixed time, the body only needs to make progress
+            if (previousPhase != HTTP_REQUEST_HEADER)
+                trackProgress(length);
+            else if (!isFinal && _parser.getPhase() != HTTP_REQUEST_HEADER)
+            {
+                startPhase(_config->bodyTimeout, true);
+                checkRequestHeader(_parser.getRequestHeader(), true);
+            }
+            else if (_parser.getPhase() == HTTP_REQUEST_COMPLETED)
+                checkRequestHeader(_parser.getRequestHeader(), false);
+
+            if (isFinal)
             {
                 switch (_parser.getPhase())
                 {
@@ -83,19 +109,7 @@ void HttpClient::handleEvents(uint32_t eventMask)
                 case HTTP_REQUEST_MALFORMED:
                     throw HttpException(400);
                 case HTTP_REQUEST_COMPLETED:
-                {
-                    // Adjust the server configuration to match the requested server by its host, taking the first one if not found
-                    const HttpRequest::Header *host = _parser.getRequest().findHeader(C_SLICE("Host"));
-                    if (host != NULL)
-                    {
-                        Slice serverName = host->getValue();
-                        Slice port;
-                        serverName.splitEnd(':', port);
-                        (void)port;
-                        _config = _config->findServer(serverName);
-                    }
                     handleRequest(_parser.getRequest());
-                }
                 default:
                     break;
                 }
@@ -111,97 +125,212 @@ void HttpClient::handleEvents(uint32_t eventMask)
 
     if (eventMask & EPOLLOUT)
     {
+        // Send a pending `100 Continue` before anything else
+        if (!_interimResponse.isEmpty())
+        {
+            ssize_t result = send(_fileno, &_interimResponse[0], _interimResponse.getLength(), MSG_DONTWAIT);
+            if (result <= 0)
+                throw std::runtime_error("Unable to send data to socket");
+            _interimResponse.consumeStart(static_cast<size_t>(result));
+            if (!_interimResponse.isEmpty())
+                return;
+
+            // Continue to receive the body unless the final response is ready already
+            if (_response.getState() != HTTP_RESPONSE_FINALIZED)
+            {
+                _application._dispatcher.modify(_fileno, EPOLLIN | EPOLLHUP, this);
+                return;
+            }
+#ifdef __42_LIKES_WASTING_CPU_CYCLES__
+            return;
+#endif // __42_LIKES_WASTING_CPU_CYCLES__
+        }
+
         if (_response.hasData())
-            _response.transferToSocket(_fileno);
+            trackProgress(_response.transferToSocket(_fileno));
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+        if (_response.isWaitingForFile())
+        {
+            startReadahead();
+            return;
+        }
+#endif // __42_LIKES_WASTING_CPU_CYCLES__
         if (!_response.hasData())
         {
             // Do not directly close the connection after sending the response
             // Switch back to read events and wait for the client to close the connection in
             // and set a timeout so it doesn't linger
-            _timeout = Timeout(TIMEOUT_CLOSING_MS);
+            startPhase(TIMEOUT_CLOSING_MS, false);
             _application._dispatcher.modify(_fileno, EPOLLIN | EPOLLHUP, this);
             _waitingForClose = true;
         }
     }
 }
 
-void HttpClient::handleRequest(const HttpRequest &request)
+/* Selects the server by the request's host and rejects the request before its body is received
+   if it can not succeed, otherwise a `100 Continue` is sent if expected by the client */
+void HttpClient::checkRequestHeader(const HttpRequest &request, bool hasPendingBody)
 {
-    if (!Utility::checkPathLevel(request.queryPath))
-        throw std::runtime_error("Client tried to access above-root directory");
+    // Adjust the server configuration to match the requested server by its host, taking the first one if not found
+    const HttpRequest::Header *host = request.findHeader(C_SLICE("Host"));
+    if (host != NULL)
+    {
+        Slice serverName = host->getValue();
+        Slice port;
+        serverName.splitEnd(':', port);
+        (void)port;
+        _config = _config->findServer(serverName);
+    }
+    checkRequestRate(request);
+
+    // A complete request is checked by `handleRequest()` anyway
+    if (!hasPendingBody)
+        return;
+    checkRequestRoute(request);
 
-    RoutingInfo info = info.findRoute(*_config, request.queryPath);
+    // HTTP/1.0 clients do not know interim responses
+    const HttpRequest::Header *expect = request.findHeader(C_SLICE("Expect"));
+    if (expect == NULL || request.isLegacy)
+        return;
+    if (!Slice(expect->getValue()).equalsIgnoreCase(C_SLICE("100-continue")))
+        throw HttpException(417);
+    _interimResponse = C_SLICE("HTTP/1.1 100 Continue\r\n\r\n");
+    _application._dispatcher.modify(_fileno, EPOLLIN | EPOLLOUT | EPOLLHUP, this);
+}
 
-    // HACK: For reusing the existing handling logic when the path must be changed
-repeat:
+/* Rejects the request if the client exceeds the request rate of the matching route */
+void HttpClient::checkRequestRate(const HttpRequest &request)
+{
+    // Only match the path prefix, nothing is looked up on the file system before the check
+    const LocalRouteConfig *route = _config->findLocation(request.queryPath);
+    if (route == NULL || route->requestRate <= 0)
+        return;
+    if (!_application._limiter.acquireRequest(_host, route->limitZone, route->requestRate, route->requestBurst))
+        throw HttpException(429);
+}
+
+/* Rejects the request if the matching route does not accept it */
+void HttpClient::checkRequestRoute(const HttpRequest &request)
+{
+    // Only the rejections of `handleRequest()` that do not depend on the body are repeated here, and only if
+    // the route is cached; resolving it would block the event loop on the file system
+    const RoutingInfo *cachedInfo = _application._routeCache.find(*_config, request.queryPath);
+    if (cachedInfo == NULL)
+        return;
+    const RoutingInfo &info = *cachedInfo;
     if (info.status == ROUTING_STATUS_NOT_FOUND)
         throw HttpException(404);
     else if (info.status == ROUTING_STATUS_NO_ACCESS)
         throw HttpException(403);
     else if (info.status == ROUTING_STATUS_FOUND_LOCAL)
     {
-        std::set<HttpMethod>::iterator it = info.getLocalRoute()->allowedMethods.find(request.method);
-        if (it == info.getLocalRoute()->allowedMethods.end())
+        if (info.getLocalRoute()->allowedMethods.count(request.method) == 0)
+            throw HttpException(405);
+        if (info.getLocalNodeType() == NODE_TYPE_DIRECTORY && request.method == HTTP_METHOD_POST
+         && !info.getLocalRoute()->allowUpload)
+            throw HttpException(403);
+    }
+    else if (info.status == ROUTING_STATUS_FOUND_REDIRECT)
+    {
+        if (info.getRedirectRoute()->allowedMethods.count(request.method) == 0)
+            throw HttpException(405);
+    }
+}
+
+/* Checks whether the request may be answered with a directory's index file */
+static bool allowsIndexFile(const HttpRequest &request)
+{
+    return request.method != HTTP_METHOD_POST && Slice(request.queryPath).endsWith(C_SLICE("/"));
+}
+
+/* Checks whether the route's index file is served in place of its directory */
+static bool hasIndexFile(const RoutingInfo &info, bool allowsIndex)
+{
+    return allowsIndex && info.status == ROUTING_STATUS_FOUND_LOCAL && info.getLocalNodeType() == NODE_TYPE_DIRECTORY
+        && !info.getLocalRoute()->indexFile.empty();
+}
+
+/* Handles the request, its route is resolved on the task pool unless it was resolved recently */
+void HttpClient::handleRequest(const HttpRequest &request)
+{
+    // A directory's index file is served in place of the directory, both lookups are cached
+    const RoutingInfo *info = _application._routeCache.find(*_config, request.queryPath);
+    const RoutingInfo *indexInfo = NULL;
+    bool               hasIndex = info != NULL && hasIndexFile(*info, allowsIndexFile(request));
+    if (hasIndex)
+        indexInfo = _application._routeCache.find(*_config, request.queryPath.toString() + '/'
+                                                  + info->getLocalRoute()->indexFile);
+
+    if (info == NULL || (hasIndex && indexInfo == NULL))
+        startRouteTask(request);
+    else
+        routeRequest(request, *info, indexInfo);
+
+    // A running CGI process or task sets up the response once it is finished
+    if (_process != NULL || _task != NULL)
+        return;
+    if (_response.getState() != HTTP_RESPONSE_FINALIZED)
+        throw HttpException(500);
+    _application._dispatcher.modify(_fileno, EPOLLOUT | EPOLLHUP, this);
+    startPhase(_config->sendTimeout, true);
+}
+
+/* Handles the request according to its route, and the route of the directory's index file if it is served
+   in place of the directory */
+void HttpClient::routeRequest(const HttpRequest &request, const RoutingInfo &routeInfo, const RoutingInfo *indexInfo)
+{
+    const RoutingInfo *info = &routeInfo;
+    if (indexInfo != NULL)
+    {
+        if (info->getLocalRoute()->allowedMethods.count(request.method) == 0)
             throw HttpException(405);
+        info = indexInfo;
 
-        switch (info.getLocalNodeType())
+        // Prevent serving a directory in place of the index file on a misconfigured server
+        if (info->status == ROUTING_STATUS_FOUND_LOCAL && info->getLocalNodeType() == NODE_TYPE_DIRECTORY)
+            throw HttpException(500);
+    }
+
+    if (info->status == ROUTING_STATUS_NOT_FOUND)
+        throw HttpException(404);
+    else if (info->status == ROUTING_STATUS_NO_ACCESS)
+        throw HttpException(403);
+    else if (info->status == ROUTING_STATUS_FOUND_LOCAL)
+    {
+        std::set<HttpMethod>::iterator it = info->getLocalRoute()->allowedMethods.find(request.method);
+        if (it == info->getLocalRoute()->allowedMethods.end())
+            throw HttpException(405);
+
+        switch (info->getLocalNodeType())
         {
         case NODE_TYPE_REGULAR:
-            if (info.hasCgiInterpreter)
+            if (info->hasCgiInterpreter)
             {
-                _application.startCgiProcess(this, request, info);
+                _application.startCgiProcess(this, request, *info);
                 _timeout.stop();
+                _isRateChecked = false;
             }
             else if (request.method == HTTP_METHOD_DELETE)
-            {
-                 if (unlink(info.nodePath.c_str()) == -1)
-                    throw HttpException(403);
-                _response.initializeEmpty(204, C_SLICE("No Content"));
-                _timeout = Timeout(_response.finalizeHeader());
-            }
+                startTask(CLIENT_TASK_DELETE, request, info->nodePath);
             else
-            {
-                setupFileResponse(200, C_SLICE("OK"), info.nodePath);
-            }
+                startFileTask(request, info->nodePath, info->getLocalRoute());
             break;
         case NODE_TYPE_DIRECTORY:
             if (request.method == HTTP_METHOD_POST)
             {
-                if (info.getLocalRoute()->allowUpload)
-                {
-                    UploadHandler::handleUpload(request, info);
-
-                    // Redirect the client to the upload directory
-                    _response.initializeEmpty(303, C_SLICE("See Other"));
-                    _response.addHeader(C_SLICE("Location"), request.queryPath);
-                    _response.finalizeHeader();
-                }
+                if (info->getLocalRoute()->allowUpload)
+                    startTask(CLIENT_TASK_UPLOAD, request, info->nodePath);
                 else
                     throw HttpException(403);
             }
             else if (!Slice(request.queryPath).endsWith(C_SLICE("/")))
             {
                 _response.initializeEmpty(301, C_SLICE("Moved Permanently"));
-                _response.addHeader(C_SLICE("Location"), Slice(request.queryPath + "/"));
-                _timeout = Timeout(_response.finalizeHeader());
-            }
-            else if (!info.getLocalRoute()->indexFile.empty())
-            {
-                // HACK: Temporary solution for directory index access, refactor after the
-                //       whole handling logic is done
-                std::string newPath = request.queryPath + '/' + info.getLocalRoute()->indexFile;
-                info = RoutingInfo::findRoute(*_config, newPath);
-                // HACK: Prevent infinite loop on misconfigured server
-                if (info.status != ROUTING_STATUS_FOUND_LOCAL || info.getLocalNodeType() != NODE_TYPE_DIRECTORY)
-                    goto repeat;
-                throw HttpException(500);
-            }
-            else if (info.getLocalRoute()->allowListing)
-            {
-                _response.initializeOwned(200, C_SLICE("OK"), HtmlGenerator::directoryList(info.nodePath.c_str()));
-                _response.addHeader(C_SLICE("Content-Type"), C_SLICE("text/html"));
-                _timeout = Timeout(_response.finalizeHeader());
+                _response.addHeader(C_SLICE("Location"), Slice(request.queryPath.toString() + "/"));
+                _response.finalizeHeader();
             }
+            else if (info->getLocalRoute()->allowListing)
+                startTask(CLIENT_TASK_LISTING, request, info->nodePath);
             else
                 throw HttpException(403);
             break;
@@ -209,38 +338,370 @@ repeat:
             break;
         }
     }
-    else if (info.status == ROUTING_STATUS_FOUND_REDIRECT)
+    else if (info->status == ROUTING_STATUS_FOUND_REDIRECT)
     {
-        std::set<HttpMethod>::iterator it = info.getRedirectRoute()->allowedMethods.find(request.method);
-        if (it == info.getRedirectRoute()->allowedMethods.end())
+        std::set<HttpMethod>::iterator it = info->getRedirectRoute()->allowedMethods.find(request.method);
+        if (it == info->getRedirectRoute()->allowedMethods.end())
             throw HttpException(405);
 
         Slice routeRelativeQuery = Slice(request.query)
-            .cut(info.getRedirectRoute()->path.size());
+            .cut(info->getRedirectRoute()->path.size());
         routeRelativeQuery.consumeStart(C_SLICE("/"));
 
-        Slice rewritePrefix = Slice(info.getRedirectRoute()->redirectLocation)
+        Slice rewritePrefix = Slice(info->getRedirectRoute()->redirectLocation)
             .stripEnd('/');
 
         _response.initializeEmpty(307, C_SLICE("Temporary Redirect"));
         _response.addHeader(C_SLICE("Location"),  rewritePrefix.toString() + '/' + routeRelativeQuery.toString());
-        _timeout = Timeout(_response.finalizeHeader());
+        _response.finalizeHeader();
     }
+}
 
-    if (_response.getState() != HTTP_RESPONSE_FINALIZED && _process == NULL)
-        throw HttpException(500);
-    if (_process == NULL)
-        _application._dispatcher.modify(_fileno, EPOLLOUT | EPOLLHUP, this);
+/* Checks whether the entity tag is contained in the given `If-None-Match` or `If-Range` list,
+   weak tags are only accepted if `isWeakMatch` is set */
+static bool matchEntityTag(Slice list, Slice entityTag, bool isWeakMatch)
+{
+    list.stripStart(' ');
+    if (list == C_SLICE("*"))
+        return true;
+    while (list.getLength() > 0)
+    {
+        Slice item;
+        if (!list.splitStart(',', item))
+        {
+            item = list;
+            list = Slice();
+        }
+        item.stripStart(' ').stripEnd(' ');
+        list.stripStart(' ');
+        if (item.removePrefix(C_SLICE("W/")) && !isWeakMatch)
+            continue;
+        if (item == entityTag)
+            return true;
+    }
+    return false;
 }
 
-void HttpClient::setupFileResponse(size_t statusCode, Slice statusMessage, const std::string &path)
+/* Checks whether the client's cached copy of a file is still current */
+static bool isNotModified(const HttpRequest &request, Slice entityTag, time_t modificationTime)
+{
+    // `If-None-Match` takes precedence, the date is ignored if it is present
+    const HttpRequest::Header *ifNoneMatch = request.findHeader(C_SLICE("If-None-Match"));
+    if (ifNoneMatch != NULL)
+        return matchEntityTag(ifNoneMatch->getValue(), entityTag, true);
+
+    const HttpRequest::Header *ifModifiedSince = request.findHeader(C_SLICE("If-Modified-Since"));
+    time_t                     clientTime;
+    if (ifModifiedSince != NULL && Utility::parseHttpDate(ifModifiedSince->getValue(), clientTime))
+        return modificationTime <= clientTime;
+    return false;
+}
+
+/* Checks whether the given content coding is acceptable according to an `Accept-Encoding` list */
+static bool isEncodingAccepted(Slice list, Slice encoding)
 {
-    std::string mimeType = g_mimeDB.getMimeType(path);
+    bool isWildcardAccepted = false;
+    while (list.getLength() > 0)
+    {
+        Slice item;
+        if (!list.splitStart(',', item))
+        {
+            item = list;
+            list = Slice();
+        }
 
-    // Setup a file stream response
+        // Split off the parameters, only the quality value is of interest
+        Slice name;
+        Slice parameters = item;
+        if (!parameters.splitStart(';', name))
+        {
+            name = item;
+            parameters = Slice();
+        }
+        name.stripStart(' ').stripEnd(' ');
+        parameters.stripStart(' ');
+
+        // A quality of zero ("q=0", "q=0.000") explicitly rejects the coding
+        bool isRejected = false;
+        if (parameters.consumeStart(C_SLICE("q=")) && parameters.consumeStart(C_SLICE("0")))
+        {
+            isRejected = true;
+            for (size_t index = 0; index < parameters.getLength(); index++)
+                if (parameters[index] != '.' && parameters[index] != '0')
+                    isRejected = false;
+        }
+
+        if (name.equalsIgnoreCase(encoding))
+            return !isRejected;
+        if (name == C_SLICE("*"))
+            isWildcardAccepted = !isRejected;
+    }
+    return isWildcardAccepted;
+}
+
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+
+/* Owns an opened file descriptor until it is handed over, closes it otherwise */
+class FileHandle
+{
+public:
+    inline FileHandle()
+        : _fileno(-1)
+    {
+    }
+
+    inline ~FileHandle()
+    {
+        reset(-1);
+    }
+
+    /* Gets the descriptor without giving up its ownership */
+    inline int get() const
+    {
+        return _fileno;
+    }
+
+    /* Closes the current descriptor and takes ownership of the given one */
+    inline void reset(int fileno)
+    {
+        if (_fileno >= 0)
+            close(_fileno);
+        _fileno = fileno;
+    }
+
+    /* Gives up the ownership of the descriptor */
+    inline int release()
+    {
+        int fileno = _fileno;
+        _fileno = -1;
+        return fileno;
+    }
+private:
+    int _fileno;
+
+    /* Disable copy-construction and copy-assignment */
+    FileHandle(const FileHandle &other);
+    FileHandle &operator=(const FileHandle &other);
+};
+
+/* Opens the regular file at the given path below the route's root directory (if it is open) and queries
+   its status, returns whether it succeeded */
+static bool openStaticFile(const LocalRouteConfig *route, const std::string &path, FileHandle &outFile,
+                           struct stat &outStatus)
+{
+    int flags = O_RDONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC;
+    if (route != NULL && route->rootFileno >= 0)
+        outFile.reset(Utility::openBeneath(route->rootFileno, route->getRelativePath(path), flags));
+    else
+        outFile.reset(open(path.c_str(), flags));
+    if (outFile.get() < 0)
+        return false;
+    if (fstat(outFile.get(), &outStatus) != 0 || !S_ISREG(outStatus.st_mode))
+    {
+        outFile.reset(-1);
+        return false;
+    }
+    return true;
+}
+
+#endif // __42_LIKES_WASTING_CPU_CYCLES__
+
+/* Finds a precompressed sibling of the file at the given path that is accepted according to the client's
+   `Accept-Encoding` list, returns its content coding or an empty slice if there is none */
+#ifdef __42_LIKES_WASTING_CPU_CYCLES__
+static Slice findPrecompressed(Slice acceptEncoding, const std::string &path,
+                               std::string &outPath, struct stat &outStatus)
+#else
+static Slice findPrecompressed(Slice acceptEncoding, const LocalRouteConfig *route, const std::string &path,
+                               std::string &outPath, FileHandle &outFile, struct stat &outStatus)
+#endif
+{
+    static const char *const encodings[][2] = { { "br", ".br" }, { "gzip", ".gz" } };
+
+    // Brotli usually compresses better, so it is preferred
+    for (size_t index = 0; index < sizeof(encodings) / sizeof(encodings[0]); index++)
+    {
+        Slice encoding(encodings[index][0], std::strlen(encodings[index][0]));
+        if (!isEncodingAccepted(acceptEncoding, encoding))
+            continue;
+        std::string siblingPath = path + encodings[index][1];
+#ifdef __42_LIKES_WASTING_CPU_CYCLES__
+        if (stat(siblingPath.c_str(), &outStatus) == 0 && S_ISREG(outStatus.st_mode))
+#else
+        if (openStaticFile(route, siblingPath, outFile, outStatus))
+#endif
+        {
+            outPath = siblingPath;
+            return encoding;
+        }
+    }
+    return Slice();
+}
+
+/* Initializes the response object to send the file at the given path as a whole, used for error pages */
+void HttpClient::setupFileResponse(size_t statusCode, Slice statusMessage, const std::string &path)
+{
     _response.initializeFileStream(statusCode, statusMessage, path.c_str());
-    _response.addHeader(C_SLICE("Content-Type"), mimeType);
-    _timeout = Timeout(_response.finalizeHeader());
+    _response.addHeader(C_SLICE("Content-Type"), g_mimeDB.getMimeType(path));
+    _response.finalizeHeader();
+}
+
+/* Initializes the response object to use the static file opened by the task, honoring the ranges requested
+   by `request` (if any); the task opened a precompressed sibling of the file instead if the route allows it
+   and the client accepts it */
+void HttpClient::setupFileResponse(const HttpRequest &request, ClientTask &task)
+{
+    // The content type is always that of the uncompressed file
+    const std::string &path = task.path;
+    const std::string &filePath = task.filePath;
+    const struct stat &status = task.status;
+    std::string        mimeType = g_mimeDB.getMimeType(path);
+    Slice              contentEncoding = task.contentEncoding;
+    bool               allowPrecompressed = task.localRoute != NULL && task.localRoute->gzipStatic;
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+    // The descriptor is handed over to the response if the file is sent
+    FileHandle file;
+    file.reset(task.fileno);
+    task.fileno = -1;
+#endif
+    size_t      fileSize = static_cast<size_t>(status.st_size);
+    std::string lastModified = Utility::formatHttpDate(status.st_mtime);
+
+    // The entity tag changes whenever the file is replaced, resized or modified
+    std::stringstream entityTagStream;
+    entityTagStream << '"' << std::hex << status.st_ino << '-' << status.st_size << '-' << status.st_mtime << '"';
+    std::string entityTag = entityTagStream.str();
+
+    // Files of the configured types are compressed once and then served from the cache,
+    // ranges always refer to the uncompressed file
+    const HttpRequest::Header *range = request.findHeader(C_SLICE("Range"));
+    bool isCompressible = request.method == HTTP_METHOD_GET && contentEncoding.isEmpty()
+        && fileSize >= _config->gzipMinLength && fileSize <= COMPRESSION_MAX_FILE_SIZE
+        && Compression::matchesType(_config->gzipTypes, mimeType);
+    bool shouldCompress = isCompressible && range == NULL && acceptsGzip(request);
+    bool hasVary = allowPrecompressed || isCompressible;
+    std::string identityTag = entityTag;
+    if (shouldCompress)
+        entityTag.insert(entityTag.size() - 1, "-gzip");
+
+    // Let the client reuse its cached copy without sending the file
+    if (request.method == HTTP_METHOD_GET && isNotModified(request, entityTag, status.st_mtime))
+    {
+        _response.initializeEmpty(304, C_SLICE("Not Modified"));
+        _response.addHeader(C_SLICE("ETag"), entityTag);
+        _response.addHeader(C_SLICE("Last-Modified"), lastModified);
+        if (hasVary)
+            _response.addHeader(C_SLICE("Vary"), C_SLICE("Accept-Encoding"));
+        _response.finalizeHeader();
+        return;
+    }
+
+    // Ranges are only served if the client's copy (identified by `If-Range`) is still current
+    std::vector<ByteRange> ranges;
+    ByteRangeStatus        rangeStatus = BYTE_RANGE_IGNORED;
+    const HttpRequest::Header *ifRange = request.findHeader(C_SLICE("If-Range"));
+    bool isCurrent = ifRange == NULL
+        || ifRange->getValue() == lastModified
+        || matchEntityTag(ifRange->getValue(), entityTag, false);
+    if (request.method == HTTP_METHOD_GET && range != NULL && isCurrent)
+        rangeStatus = ByteRange::parse(range->getValue(), fileSize, ranges);
+
+    switch (rangeStatus)
+    {
+    case BYTE_RANGE_SATISFIABLE:
+#ifdef __42_LIKES_WASTING_CPU_CYCLES__
+        _response.initializeFileRanges(filePath.c_str(), fileSize, ranges, mimeType);
+#else
+        _response.initializeFileRanges(file.release(), fileSize, ranges, mimeType);
+#endif
+        break;
+    case BYTE_RANGE_UNSATISFIABLE:
+        _response.initializeEmpty(416, g_errorDB.getErrorType(416));
+        _response.addHeader(C_SLICE("Content-Range"), "bytes */" + Utility::numberToString(fileSize));
+        break;
+    case BYTE_RANGE_IGNORED:
+    {
+        // Fall back to the uncompressed file until it is compressed, or if it can not be compressed
+        SharedString *compressed = NULL;
+        if (shouldCompress)
+            compressed = _application._compressionCache.getCompressedFile(filePath, status, _application._taskPool);
+        if (compressed != NULL)
+        {
+            _response.initializeShared(200, C_SLICE("OK"), compressed);
+            contentEncoding = C_SLICE("gzip");
+        }
+        else
+        {
+#ifdef __42_LIKES_WASTING_CPU_CYCLES__
+            _response.initializeFileStream(200, C_SLICE("OK"), filePath.c_str());
+#else
+            _response.initializeFileStream(200, C_SLICE("OK"), file.release(), fileSize);
+#endif
+            entityTag = identityTag;
+        }
+        _response.addHeader(C_SLICE("Content-Type"), mimeType);
+        break;
+    }
+    }
+    if (!contentEncoding.isEmpty())
+        _response.addHeader(C_SLICE("Content-Encoding"), contentEncoding);
+    if (hasVary)
+        _response.addHeader(C_SLICE("Vary"), C_SLICE("Accept-Encoding"));
+    _response.addHeader(C_SLICE("Accept-Ranges"), C_SLICE("bytes"));
+    _response.addHeader(C_SLICE("ETag"), entityTag);
+    _response.addHeader(C_SLICE("Last-Modified"), lastModified);
+    _response.finalizeHeader();
+}
+
+/* Gets the listing page (starting at 1) selected by "?page=", missing or invalid page numbers select the first */
+static size_t parseListingPage(const HttpRequest &request)
+{
+    size_t page = 1;
+    Slice  parameters = request.queryParameters;
+    while (parameters.getLength() > 0)
+    {
+        Slice parameter;
+        if (!parameters.splitStart('&', parameter))
+        {
+            parameter = parameters;
+            parameters = Slice();
+        }
+        if (parameter.consumeStart(C_SLICE("page=")) && (!Utility::parseSize(parameter, page) || page == 0))
+            page = 1;
+    }
+    return page;
+}
+
+/* Initializes the response object to list the directory at the given path and with the given status,
+   paginated by "?page=" */
+void HttpClient::setupListingResponse(const HttpRequest &request, const std::string &path, const struct stat &status)
+{
+    SharedString *body = _application._directoryCache.getPage(path, status, parseListingPage(request));
+    if (body == NULL)
+        throw HttpException(404);
+
+    _response.initializeShared(200, C_SLICE("OK"), body);
+    _response.addHeader(C_SLICE("Content-Type"), C_SLICE("text/html"));
+}
+
+/* Checks whether the client accepts gzip-compressed responses */
+bool HttpClient::acceptsGzip(const HttpRequest &request)
+{
+    const HttpRequest::Header *acceptEncoding = request.findHeader(C_SLICE("Accept-Encoding"));
+    return acceptEncoding != NULL && isEncodingAccepted(acceptEncoding->getValue(), C_SLICE("gzip"));
+}
+
+/* Compresses a generated response body if its content type is configured for compression
+   and the client accepts it */
+void HttpClient::compressResponse()
+{
+    if (_config->gzipTypes.empty() || !_response.isCompressible(_config->gzipTypes, _config->gzipMinLength))
+        return;
+
+    // Caches must not hand the compressed body to clients that did not ask for it
+    _response.addHeader(C_SLICE("Vary"), C_SLICE("Accept-Encoding"));
+    if (_parser.hasRequestHeader() && acceptsGzip(_parser.getRequestHeader()))
+        _response.compressBody();
 }
 
 /* Handles an exception that occurred in `handleEvent()` */
@@ -251,6 +712,306 @@ void HttpClient::handleException(const char *message)
     markForCleanup();
 }
 
+/* Constructs a task of the given type working on the given path */
+ClientTask::ClientTask(HttpClient *owner, ClientTaskType taskType, const std::string &nodePath)
+    : client(owner)
+    , type(taskType)
+    , path(nodePath)
+    , statusCode(0)
+    , serverConfig(NULL)
+    , allowsIndex(false)
+    , route()
+    , hasIndexRoute(false)
+    , indexRoute()
+    , localRoute(NULL)
+    , isCached(false)
+    , cachedInode(0)
+    , cachedModificationTime()
+    , status()
+    , hasNames(false)
+    , fileno(-1)
+    , offset(0)
+    , length(0)
+{
+}
+
+/* Closes the task's file descriptor (if any) */
+ClientTask::~ClientTask()
+{
+    if (fileno >= 0)
+        close(fileno);
+}
+
+/* Performs the file system operation */
+void ClientTask::execute()
+{
+    try
+    {
+        switch (type)
+        {
+        case CLIENT_TASK_ROUTE:
+            route = RoutingInfo::findRoute(*serverConfig, Slice(path));
+            hasIndexRoute = hasIndexFile(route, allowsIndex);
+            if (hasIndexRoute)
+            {
+                indexPath = path + '/' + route.getLocalRoute()->indexFile;
+                indexRoute = RoutingInfo::findRoute(*serverConfig, Slice(indexPath));
+            }
+            break;
+        case CLIENT_TASK_OPEN:
+        {
+            // The task only reports a failure, the response is set up on the event loop's thread
+            filePath = path;
+#ifdef __42_LIKES_WASTING_CPU_CYCLES__
+            if (!acceptEncoding.empty())
+                contentEncoding = findPrecompressed(Slice(acceptEncoding), path, filePath, status);
+            if (contentEncoding.isEmpty() && stat(path.c_str(), &status) != 0)
+                throw HttpException(500);
+#else
+            FileHandle file;
+            if (!acceptEncoding.empty())
+                contentEncoding = findPrecompressed(Slice(acceptEncoding), localRoute, path, filePath, file, status);
+            if (contentEncoding.isEmpty() && !openStaticFile(localRoute, path, file, status))
+                throw HttpException(500);
+            fileno = file.release();
+#endif
+            break;
+        }
+        case CLIENT_TASK_DELETE:
+            if (unlink(path.c_str()) == -1)
+                throw HttpException(403);
+            break;
+        case CLIENT_TASK_UPLOAD:
+            UploadHandler::handleUpload(contentType, body, path);
+            break;
+        case CLIENT_TASK_LISTING:
+            if (stat(path.c_str(), &status) != 0)
+                throw HttpException(404);
+
+            // The cache is only updated on the event loop's thread, the task only reads a modified directory
+            hasNames = !isCached || status.st_ino != cachedInode
+                || status.st_mtim.tv_sec != cachedModificationTime.tv_sec
+                || status.st_mtim.tv_nsec != cachedModificationTime.tv_nsec;
+            if (hasNames)
+                DirectoryCache::readNames(path, names);
+            break;
+        case CLIENT_TASK_READAHEAD:
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+            // Failures are left to the response, which reports them once it reads the range itself
+            readahead(fileno, static_cast<off64_t>(offset), length);
+#endif // __42_LIKES_WASTING_CPU_CYCLES__
+            break;
+        }
+    }
+    catch (HttpException &exception)
+    {
+        statusCode = exception.getStatusCode();
+    }
+    catch (...)
+    {
+        statusCode = 500;
+    }
+}
+
+/* Lets the client (if it still exists) respond with the result */
+void ClientTask::finish()
+{
+    if (client == NULL)
+        return;
+    try
+    {
+        client->finishTask(*this);
+    }
+    catch (const std::exception &exception)
+    {
+        client->handleException(exception.what());
+    }
+}
+
+/* Hands a file system operation of the request to the task pool, only a hangup is handled until it is finished */
+void HttpClient::startTask(ClientTaskType type, const HttpRequest &request, const std::string &path)
+{
+    // The task takes copies of everything it works on, the body is moved out of the request
+    ClientTask *task = new ClientTask(this, type, path);
+    try
+    {
+        if (type == CLIENT_TASK_UPLOAD)
+        {
+            const HttpRequest::Header *contentType = request.findHeader(C_SLICE("Content-Type"));
+            if (contentType != NULL)
+                task->contentType = contentType->getValue().toString();
+            _parser.takeBody(task->body);
+        }
+        else if (type == CLIENT_TASK_LISTING)
+            task->isCached = _application._directoryCache.findVersion(path, parseListingPage(request),
+                                                                      task->cachedInode, task->cachedModificationTime);
+    }
+    catch (...)
+    {
+        delete task;
+        throw;
+    }
+
+    submitTask(task);
+}
+
+/* Lets the task pool resolve the request's route, and that of the index file if the route is a directory */
+void HttpClient::startRouteTask(const HttpRequest &request)
+{
+    ClientTask *task = new ClientTask(this, CLIENT_TASK_ROUTE, std::string());
+    try
+    {
+        task->path = request.queryPath.toString();
+    }
+    catch (...)
+    {
+        delete task;
+        throw;
+    }
+    task->serverConfig = _config;
+    task->allowsIndex  = allowsIndexFile(request);
+    submitTask(task);
+}
+
+/* Lets the task pool open the static file at the given path below the route's root directory */
+void HttpClient::startFileTask(const HttpRequest &request, const std::string &path, const LocalRouteConfig *route)
+{
+    ClientTask *task = new ClientTask(this, CLIENT_TASK_OPEN, path);
+    try
+    {
+        // Precompressed siblings are only looked for if they may be sent
+        const HttpRequest::Header *acceptEncoding = request.findHeader(C_SLICE("Accept-Encoding"));
+        if (route != NULL && route->gzipStatic && request.method == HTTP_METHOD_GET && acceptEncoding != NULL)
+            task->acceptEncoding = acceptEncoding->getValue().toString();
+    }
+    catch (...)
+    {
+        delete task;
+        throw;
+    }
+    task->localRoute = route;
+    submitTask(task);
+}
+
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+
+/* Lets the task pool read the range of the response's file that sending waits for into the page cache */
+void HttpClient::startReadahead()
+{
+    int    fileno;
+    size_t offset, length;
+    _response.getColdRange(fileno, offset, length);
+
+    // The response may close its descriptor before the task is finished, so the task reads through
+    // its own one; without it the range is sent right away
+    int taskFileno = fcntl(fileno, F_DUPFD_CLOEXEC, 0);
+    if (taskFileno < 0)
+    {
+        _response.resumeFile();
+        return;
+    }
+    ClientTask *task;
+    try
+    {
+        task = new ClientTask(this, CLIENT_TASK_READAHEAD, std::string());
+    }
+    catch (...)
+    {
+        close(taskFileno);
+        throw;
+    }
+    task->fileno = taskFileno;
+    task->offset = offset;
+    task->length = length;
+    submitTask(task);
+}
+
+#endif // __42_LIKES_WASTING_CPU_CYCLES__
+
+/* Hands the task to the task pool, taking ownership of it; only a hangup is handled until it is finished */
+void HttpClient::submitTask(ClientTask *task)
+{
+    // The pool destroys the task, it may even be finished right away
+    _task = task;
+    try
+    {
+        _application._taskPool.submit(task);
+    }
+    catch (...)
+    {
+        _task = NULL;
+        throw;
+    }
+    if (_task != NULL)
+    {
+        _application._dispatcher.modify(_fileno, EPOLLHUP, this);
+        _timeout.stop();
+        _isRateChecked = false;
+    }
+}
+
+/* Responds with the result of the request's file system operation */
+void HttpClient::finishTask(ClientTask &task)
+{
+    _task = NULL;
+    try
+    {
+        if (task.statusCode != 0)
+            throw HttpException(task.statusCode);
+
+        switch (task.type)
+        {
+        case CLIENT_TASK_ROUTE:
+            _application._routeCache.insert(*task.serverConfig, task.path, task.route);
+            if (task.hasIndexRoute)
+                _application._routeCache.insert(*task.serverConfig, task.indexPath, task.indexRoute);
+            routeRequest(_parser.getRequest(), task.route, task.hasIndexRoute ? &task.indexRoute : NULL);
+            break;
+        case CLIENT_TASK_OPEN:
+            setupFileResponse(_parser.getRequest(), task);
+            break;
+        case CLIENT_TASK_DELETE:
+            _application._routeCache.clear();
+            _response.initializeEmpty(204, C_SLICE("No Content"));
+            _response.finalizeHeader();
+            break;
+        case CLIENT_TASK_UPLOAD:
+            _application._routeCache.clear();
+
+            // Redirect the client to the upload directory
+            _response.initializeEmpty(303, C_SLICE("See Other"));
+            _response.addHeader(C_SLICE("Location"), _parser.getRequest().queryPath);
+            _response.finalizeHeader();
+            break;
+        case CLIENT_TASK_LISTING:
+            if (task.hasNames)
+                _application._directoryCache.insert(task.path, task.status, task.names);
+            setupListingResponse(_parser.getRequest(), task.path, task.status);
+            compressResponse();
+            _response.finalizeHeader();
+            break;
+        case CLIENT_TASK_READAHEAD:
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+            _response.resumeFile();
+#endif // __42_LIKES_WASTING_CPU_CYCLES__
+            break;
+        }
+
+        // A routed request may have been handed to another task or a CGI process
+        if (_process != NULL || _task != NULL)
+            return;
+        if (_response.getState() != HTTP_RESPONSE_FINALIZED)
+            throw HttpException(500);
+    }
+    catch (HttpException &exception)
+    {
+        createErrorResponse(exception.getStatusCode());
+        return;
+    }
+    _application._dispatcher.modify(_fileno, EPOLLOUT | EPOLLHUP, this);
+    startPhase(_config->sendTimeout, true);
+}
+
 void HttpClient::handleCgiState()
 {
     if (_process == NULL)
@@ -262,10 +1023,12 @@ void HttpClient::handleCgiState()
         case CGI_PROCESS_SUCCESS:
         {
             _response.initializeUnownedCgi(Slice(_process->_buffer));
-            _timeout = Timeout(_response.finalizeHeader());
+            compressResponse();
+            _response.finalizeHeader();
             _application._dispatcher.unsubscribe(_process->getProcess().getOutputFileno());
             _process->_subscribeFlags &= ~SUBSCRIBE_FLAG_OUTPUT;
             _application._dispatcher.modify(_fileno, EPOLLOUT | EPOLLHUP, this);
+            startPhase(_config->sendTimeout, true);
         }
         break;
         case CGI_PROCESS_FAILURE:
@@ -295,9 +1058,19 @@ void HttpClient::createErrorResponse(size_t statusCode)
 {
     bool alreadyHandled = false;
 
+    // Error responses of known status codes were serialized at startup
+    std::map<int, PrerenderedResponse>::const_iterator prerendered = _config->errorResponses.find(statusCode);
+    if (prerendered != _config->errorResponses.end())
+    {
+        bool isCompressed = !prerendered->second.compressed.empty()
+            && _parser.hasRequestHeader() && acceptsGzip(_parser.getRequestHeader());
+        _response.initializePrerendered(isCompressed ? prerendered->second.compressed : prerendered->second.plain);
+        alreadyHandled = true;
+    }
+
     // Check if for the error code was a static error page defined in the config file
     std::map<int, std::string>::const_iterator findResult = _config->errorPages.find(statusCode);
-    if (findResult != _config->errorPages.end())
+    if (!alreadyHandled && findResult != _config->errorPages.end())
     {
         try
         {
@@ -318,9 +1091,42 @@ void HttpClient::createErrorResponse(size_t statusCode)
         // Build the response and set its timeout
         _response.initializeOwned(statusCode, errorMessage, errorPage);
         _response.addHeader(C_SLICE("Content-Type"), C_SLICE("text/html"));
-        _timeout = Timeout(_response.finalizeHeader());
+        compressResponse();
+        _response.finalizeHeader();
     }
 
     // Switch the dispatcher to POLLOUT
     _application._dispatcher.modify(_fileno, EPOLLOUT | EPOLLHUP, this);
+    startPhase(_config->sendTimeout, true);
+}
+
+/* Restarts the timeout and the data rate measurement for a new phase of the connection */
+void HttpClient::startPhase(uint64_t timeout, bool isRateChecked)
+{
+    _timeout = Timeout(timeout);
+    _phaseStartTime = Timeout::getCurrentTime();
+    _phaseBytes = 0;
+    _isRateChecked = isRateChecked;
+}
+
+/* Extends the timeout after the given number of bytes were transferred */
+void HttpClient::trackProgress(size_t byteCount)
+{
+    if (byteCount == 0)
+        return;
+    _timeout.reset();
+    _phaseBytes += byteCount;
+}
+
+/* Gets whether the client transfers data slower than the minimum data rate */
+bool HttpClient::isTooSlow()
+{
+    if (!_isRateChecked || _config->minDataRate == 0)
+        return false;
+
+    // Give the client some time before judging its average rate
+    uint64_t elapsedTime = Timeout::getCurrentTime() - _phaseStartTime;
+    if (elapsedTime < TIMEOUT_MIN_DATA_RATE_GRACE_MS)
+        return false;
+    return static_cast<uint64_t>(_phaseBytes) * 1000 / elapsedTime < _config->minDataRate;
 }
@@ -9,20 +9,80 @@
 #include "routing.hpp"
 #include "http_response.hpp"
 #include "http_request_parser.hpp"
+#include "task_pool.hpp"
 
+#include <string>
+#include <vector>
 #include <stdint.h>
+#include <sys/stat.h>
 
 class Application;
 class CgiProcess;
+class HttpServer;
+class HttpClient;
+
+enum ClientTaskType
+{
+    CLIENT_TASK_ROUTE,
+    CLIENT_TASK_OPEN,
+    CLIENT_TASK_DELETE,
+    CLIENT_TASK_UPLOAD,
+    CLIENT_TASK_LISTING,
+    CLIENT_TASK_READAHEAD
+};
+
+/* File system operation of a client's request, performed by the task pool; the task owns all
+   the data it works on, as its client may be destroyed before it finishes */
+struct ClientTask: public Task
+{
+    HttpClient              *client;      // Reset if the client is destroyed first
+    ClientTaskType           type;
+    std::string              path;           // The query path when resolving a route, the node path otherwise
+    size_t                   statusCode;     // Error status code, 0 on success
+    const ServerConfig      *serverConfig;   // Route only, the server whose routes are searched
+    bool                     allowsIndex;    // Route only, set if a directory is answered with its index file
+    RoutingInfo              route;
+    bool                     hasIndexRoute;  // Route only, set if the index file's route was resolved as well
+    std::string              indexPath;
+    RoutingInfo              indexRoute;
+    const LocalRouteConfig  *localRoute;     // Open only, the route serving the file
+    std::string              acceptEncoding; // Open only, the codings of precompressed siblings the client accepts
+    std::string              filePath;       // Open only, the opened file which may be a precompressed sibling
+    Slice                    contentEncoding;
+    std::string              contentType;    // Upload only
+    std::vector<uint8_t>     body;           // Upload only
+    bool                     isCached;       // Listing only, the cached version of the directory
+    ino_t                    cachedInode;
+    timespec                 cachedModificationTime;
+    struct stat              status;         // Open and listing only
+    bool                     hasNames;       // Listing only, set if the directory was read again
+    std::vector<std::string> names;
+    int                      fileno;         // Open and read-ahead only, a descriptor owned by the task
+    size_t                   offset;         // Read-ahead only
+    size_t                   length;
+
+    /* Constructs a task of the given type working on the given path */
+    ClientTask(HttpClient *owner, ClientTaskType taskType, const std::string &nodePath);
+
+    /* Closes the task's file descriptor (if any) */
+    ~ClientTask();
+
+    /* Performs the file system operation */
+    void execute();
+
+    /* Lets the client (if it still exists) respond with the result */
+    void finish();
+};
 
 class HttpClient: public Sink
 {
 public:
     friend class Application;
     friend class CgiProcess;
+    friend struct ClientTask;
 
-    /* Constructs a HTTP client using the given socket file descriptor */
-    HttpClient(Application &application, const ServerConfig *config, int fileno, uint32_t host, uint16_t port);
+    /* Constructs a HTTP client of the given server using the given socket file descriptor */
+    HttpClient(Application &application, HttpServer &server, int fileno, uint32_t host, uint16_t port);
 
     /* Closes the client's file descriptor */
     ~HttpClient();
@@ -41,6 +101,7 @@ public:
 private:
     Application        &_application;
     const ServerConfig *_config;
+    HttpServer         *_server;
     int                 _fileno;
     Timeout             _timeout;
     HttpClient         *_next;
@@ -48,30 +109,96 @@ private:
     HttpClient         *_cleanupNext;
     bool                _waitingForClose;
     bool                _markedForCleanup;
+    bool                _hasConnectionSlot;
     CgiProcess         *_process;
+    ClientTask         *_task; // File system operation in progress
     uint32_t            _host;
     uint16_t            _port;
+    Arena               _arena; // Holds the data of the current request
     HttpRequestParser   _parser;
     HttpResponse        _response;
+    uint64_t            _phaseStartTime;
+    size_t              _phaseBytes;
+    bool                _isRateChecked;
+    Slice               _interimResponse;
 
     /* Handles one or multiple events */
     void handleEvents(uint32_t eventMask);
 
-    /* Handles the request*/
+    /* Selects the server by the request's host and rejects the request before its body is received
+       if it can not succeed, otherwise a `100 Continue` is sent if expected by the client */
+    void checkRequestHeader(const HttpRequest &request, bool hasPendingBody);
+
+    /* Rejects the request if the client exceeds the request rate of the matching route */
+    void checkRequestRate(const HttpRequest &request);
+
+    /* Rejects the request if the matching route does not accept it */
+    void checkRequestRoute(const HttpRequest &request);
+
+    /* Handles the request, its route is resolved on the task pool unless it was resolved recently */
     void handleRequest(const HttpRequest &request); // take reference for all the requests
 
-    /* Initializes the response object to use a static file */
+    /* Handles the request according to its route, and the route of the directory's index file if it is served
+       in place of the directory */
+    void routeRequest(const HttpRequest &request, const RoutingInfo &routeInfo, const RoutingInfo *indexInfo);
+
+    /* Initializes the response object to send the file at the given path as a whole, used for error pages */
     void setupFileResponse(size_t statusCode, Slice statusMessage, const std::string &path);
 
+    /* Initializes the response object to use the static file opened by the task, honoring the ranges requested
+       by `request` (if any); the task opened a precompressed sibling of the file instead if the route allows it
+       and the client accepts it */
+    void setupFileResponse(const HttpRequest &request, ClientTask &task);
+
+    /* Initializes the response object to list the directory at the given path and with the given status,
+       paginated by "?page=" */
+    void setupListingResponse(const HttpRequest &request, const std::string &path, const struct stat &status);
+
+    /* Checks whether the client accepts gzip-compressed responses */
+    static bool acceptsGzip(const HttpRequest &request);
+
+    /* Compresses a generated response body if its content type is configured for compression
+       and the client accepts it */
+    void compressResponse();
+
     /* Handles an exception that occurred in `handleEvent()` */
     void handleException(const char *message);
 
+    /* Hands a file system operation of the request to the task pool, only a hangup is handled until it is finished */
+    void startTask(ClientTaskType type, const HttpRequest &request, const std::string &path);
+
+    /* Lets the task pool resolve the request's route, and that of the index file if the route is a directory */
+    void startRouteTask(const HttpRequest &request);
+
+    /* Lets the task pool open the static file at the given path below the route's root directory */
+    void startFileTask(const HttpRequest &request, const std::string &path, const LocalRouteConfig *route);
+
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+    /* Lets the task pool read the range of the response's file that sending waits for into the page cache */
+    void startReadahead();
+#endif
+
+    /* Hands the task to the task pool, taking ownership of it; only a hangup is handled until it is finished */
+    void submitTask(ClientTask *task);
+
+    /* Responds with the result of the request's file system operation */
+    void finishTask(ClientTask &task);
+
     /* Handles a CGI process event */
     void handleCgiState();
 
     /* Marks the client to be cleaned up during the next cleanup cycle */
     void markForCleanup();
 
+    /* Restarts the timeout and the data rate measurement for a new phase of the connection */
+    void startPhase(uint64_t timeout, bool isRateChecked);
+
+    /* Extends the timeout after the given number of bytes were transferred */
+    void trackProgress(size_t byteCount);
+
+    /* Gets whether the client transfers data slower than the minimum data rate */
+    bool isTooSlow();
+
     /* Disable copy-construction and copy-assignment */
     HttpClient(const HttpClient &other);
     HttpClient &operator=(const HttpClient &other);
@@ -1,7 +1,8 @@
 #include "http_request.hpp"
 
-/* Constructs a HTTP header pair using its key and value */
-HttpRequest::Header::Header(const std::string &key, const std::string &value)
+/* Constructs a HTTP header pair using its key and value
+   NOTE: The slices refer to the request's arena, see `HttpRequestParser` */
+HttpRequest::Header::Header(Slice key, Slice value)
     : _key(key)
     , _value(value)
 {
@@ -10,20 +11,24 @@ HttpRequest::Header::Header(const std::string &key, const std::string &value)
 /* Case-invariantly checks if the given key matches with the header's key */
 bool HttpRequest::Header::matchKey(Slice key) const
 {
-    if (_key.size() != key.getLength())
-        return false;
-    for (size_t index = 0; index < key.getLength(); index++)
-    {
-        if (std::tolower(_key[index]) != std::tolower(key[index]))
-            return false;
-    }
-    return true;
+    return _key.equalsIgnoreCase(key);
+}
+
+/* Constructs an empty request */
+HttpRequest::HttpRequest()
+    : method(HTTP_METHOD_NONE)
+    , clientHost(0)
+    , clientPort(0)
+    , isLegacy(false)
+    , headers(NULL)
+    , headerCount(0)
+{
 }
 
-/* Case-invariantly finds a header in the given vector of headers */
-const HttpRequest::Header *HttpRequest::findHeaderIn(const std::vector<Header> &headers, Slice key)
+/* Case-invariantly finds a header in the current request */
+const HttpRequest::Header *HttpRequest::findHeader(Slice key) const
 {
-    for (size_t index = 0; index < headers.size(); index++)
+    for (size_t index = 0; index < headerCount; index++)
     {
         if (headers[index].matchKey(key))
             return &headers[index];
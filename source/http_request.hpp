@@ -4,7 +4,6 @@
 #include "slice.hpp"
 #include "http_constants.hpp"
 
-#include <string>
 #include <vector>
 #include <stddef.h>
 #include <stdint.h>
@@ -14,46 +13,46 @@ struct HttpRequest
     class Header
     {
     public:
-        /* Constructs a HTTP header pair using its key and value */
-        Header(const std::string &key, const std::string &value);
+        /* Constructs a HTTP header pair using its key and value
+           NOTE: The slices refer to the request's arena, see `HttpRequestParser` */
+        Header(Slice key, Slice value);
 
         /* Case-invariantly checks if the given key matches with the header's key */
         bool matchKey(Slice key) const;
 
         /* Gets the header's key */
-        inline const std::string &getKey() const
+        inline Slice getKey() const
         {
             return _key;
         }
 
         /* Gets the header's value */
-        inline const std::string &getValue() const
+        inline Slice getValue() const
         {
             return _value;
         }
     private:
-        std::string _key;
-        std::string _value;
+        Slice _key;
+        Slice _value;
     };
 
+    // NOTE: All slices refer to the arena of the connection that received the request
     HttpMethod           method;
     uint32_t             clientHost;
     uint16_t             clientPort;
-    std::string          query;           // Full URL-encoded query string; eg. "/cgi-bin/demo.py?hello=world&abc=def"
-    std::string          queryPath;       // URL-decoded query path; eg. "/cgi-bin/demo.py"
+    Slice                query;           // Full URL-encoded query string; eg. "/cgi-bin/demo.py?hello=world&abc=def"
+    Slice                queryPath;       // URL-decoded and normalized query path; eg. "/cgi-bin/demo.py"
     Slice                queryParameters; // URL-encoded Query parameters; eg. "hello=world&abc=def"
     bool                 isLegacy;        // True when HTTP/1.0 instead of HTTP/1.1
-    std::vector<Header>  headers;
+    const Header        *headers;         // Array of `headerCount` header fields
+    size_t               headerCount;
     std::vector<uint8_t> body;
 
-    /* Case-invariantly finds a header in the current request */
-    inline const Header *findHeader(Slice key) const
-    {
-        return findHeaderIn(headers, key);
-    }
+    /* Constructs an empty request */
+    HttpRequest();
 
-    /* Case-invariantly finds a header in the given vector of headers */
-    static const Header *findHeaderIn(const std::vector<Header> &headers, Slice key);
+    /* Case-invariantly finds a header in the current request */
+    const Header *findHeader(Slice key) const;
 };
 
 #endif // HTTP_REQUEST_hpp
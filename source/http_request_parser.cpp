@@ -2,20 +2,38 @@
 #include "utility.hpp"
 #include "debug_utility.hpp"
 
+#include <new>
 #include <cstring>
 
-/* Constructs a HTTP request parser using the given rules */
-HttpRequestParser::HttpRequestParser(const ServerConfig &config, uint32_t host, uint16_t port)
+/* Constructs a HTTP request parser using the given rules, header buffers are taken from the pool
+   and only headers which overflow them borrow one from the large pool; the request's data is
+   allocated from the arena */
+HttpRequestParser::HttpRequestParser(const ServerConfig &config, uint32_t host, uint16_t port, BufferPool &pool,
+                                     BufferPool &largePool, Arena &arena)
     : _config(config)
     , _host(host)
     , _port(port)
+    , _pool(pool)
+    , _largePool(largePool)
+    , _arena(arena)
+    , _headerBuffer(NULL)
+    , _isLargeBuffer(false)
 {
+    if (pool.getBufferSize() < HTTP_REQUEST_BODY_CHUNKED_HEADER_MAX_LENGTH)
+        throw std::logic_error("Pooled buffers are too small for chunk headers");
     reset();
 }
 
-/* Prepares the parser to consume the next request */
+/* Returns the parser's buffer to the pool */
+HttpRequestParser::~HttpRequestParser()
+{
+    releaseBuffer();
+}
+
+/* Prepares the parser to consume the next request, which invalidates the arena's allocations */
 void HttpRequestParser::reset()
 {
+    _arena.reset();
     _request            = HttpRequest();
     _request.clientHost = _host;
     _request.clientPort = _port;
@@ -23,6 +41,38 @@ void HttpRequestParser::reset()
     _headerLength       = 0;
     _chunkHeaderLength  = 0;
     _isEndChunk         = false;
+    releaseBuffer();
+}
+
+/* Takes a header buffer out of the pool unless the parser holds one already */
+void HttpRequestParser::acquireBuffer()
+{
+    if (_headerBuffer == NULL)
+        _headerBuffer = _pool.acquire();
+}
+
+/* Returns the header buffer to the pool */
+void HttpRequestParser::releaseBuffer()
+{
+    if (_headerBuffer != NULL)
+        (_isLargeBuffer ? _largePool : _pool).release(_headerBuffer);
+    _headerBuffer = NULL;
+    _isLargeBuffer = false;
+}
+
+/* Moves the buffered header into a buffer of the large pool, returns false if none may be borrowed */
+bool HttpRequestParser::growBuffer()
+{
+    if (_isLargeBuffer || _largePool.getBufferSize() <= _pool.getBufferSize())
+        return false;
+    if (_config.largeHeaderBufferCount != 0 && _largePool.getUsedCount() >= _config.largeHeaderBufferCount)
+        return false;
+    char *buffer = _largePool.acquire();
+    std::memcpy(buffer, _headerBuffer, _headerLength);
+    _pool.release(_headerBuffer);
+    _headerBuffer = buffer;
+    _isLargeBuffer = true;
+    return true;
 }
 
 /* Commits data to the parser, returns whether the parser has transitioned into a final phase */
@@ -64,7 +114,10 @@ bool HttpRequestParser::commit(Slice &data)
          || _phase == HTTP_REQUEST_BODY_EXCEED
          || _phase == HTTP_REQUEST_MALFORMED
          || _phase == HTTP_REQUEST_COMPLETED)
+        {
+            releaseBuffer();
             return true;
+        }
     }
     return false;
 }
@@ -73,7 +126,9 @@ bool HttpRequestParser::commit(Slice &data)
 HttpRequestPhase HttpRequestParser::handleHeader(Slice &data)
 {
     // Calculate the maximum amount of bytes that can be copied from the data slice
-    size_t headerSpace = HTTP_REQUEST_HEADER_MAX_LENGTH - _headerLength;
+    acquireBuffer();
+    size_t headerCapacity = (_isLargeBuffer ? _largePool : _pool).getBufferSize();
+    size_t headerSpace = headerCapacity - _headerLength;
     size_t copyLength = data.getLength();
     if (copyLength > headerSpace)
         copyLength = headerSpace;
@@ -99,9 +154,9 @@ HttpRequestPhase HttpRequestParser::handleHeader(Slice &data)
         // Consume all copied bytes
         data.consumeStart(copyLength);
 
-        // If the header length has been reached, it is impossible for a header to exist,
-        // the request is malformed
-        if (_headerLength == HTTP_REQUEST_HEADER_MAX_LENGTH)
+        // Once the small buffer is full, the header continues in a large one; if the large buffer
+        // is full as well, it is impossible for a header to exist, the request is malformed
+        if (_headerLength == headerCapacity && !growBuffer())
             return HTTP_REQUEST_HEADER_EXCEED;
 
         // More data is required to complete the header
@@ -109,7 +164,7 @@ HttpRequestPhase HttpRequestParser::handleHeader(Slice &data)
     }
     size_t headerEndOffset = position - _headerBuffer;
 
-    // The header was completed, parse it
+    // The header was completed, parse it; the request does not refer to the buffer afterwards
     if (!parseHeader(Slice(_headerBuffer, headerEndOffset)))
         return HTTP_REQUEST_MALFORMED;
 
@@ -117,6 +172,7 @@ HttpRequestPhase HttpRequestParser::handleHeader(Slice &data)
     size_t remainder = _headerLength - (headerEndOffset + 4) + data.getLength() - copyLength;
     data.consumeStart(data.getLength() - remainder);
     _headerLength = 0;
+    releaseBuffer();
 
     // Search for the headers that decide the body phase and process them
     const HttpRequest::Header *contentLength = _request.findHeader(C_SLICE("Content-Length"));
@@ -124,7 +180,7 @@ HttpRequestPhase HttpRequestParser::handleHeader(Slice &data)
     if (transferEncoding != NULL)
     {
         // Only chunked transfer encoding is supported
-        if (transferEncoding->getValue() != "chunked")
+        if (transferEncoding->getValue() != C_SLICE("chunked"))
             return HTTP_REQUEST_MALFORMED;
 
         // Requests with a chunked transfer encoding can not have a content length
@@ -187,6 +243,14 @@ HttpRequestPhase HttpRequestParser::handleBodyRaw(Slice &data)
 /* Handles a data commit in the `HTTP_REQUEST_BODY_CHUNKED_HEADER` phase */
 HttpRequestPhase HttpRequestParser::handleBodyChunkedHeader(Slice &data)
 {
+    // Without a partial chunk header, decode frames directly from the data until one is cut off
+    if (_chunkHeaderLength == 0)
+    {
+        HttpRequestPhase phase = decodeChunkFrames(data);
+        if (phase != HTTP_REQUEST_BODY_CHUNKED_HEADER || data.getLength() == 0)
+            return phase;
+    }
+
     // Calculate the maximum amount of bytes that can be copied from the data slice
     size_t headerSpace = HTTP_REQUEST_BODY_CHUNKED_HEADER_MAX_LENGTH - _chunkHeaderLength;
     size_t copyLength = data.getLength();
@@ -194,8 +258,9 @@ HttpRequestPhase HttpRequestParser::handleBodyChunkedHeader(Slice &data)
         copyLength = headerSpace;
 
     // Copy the data into the header buffer and save the fresh data's offset
+    acquireBuffer();
     size_t freshOffset = _chunkHeaderLength;
-    std::memcpy(&_chunkHeaderBuffer[freshOffset], &data[0], copyLength);
+    std::memcpy(&_headerBuffer[freshOffset], &data[0], copyLength);
     _chunkHeaderLength += copyLength;
 
     // Search for CRLF from up to 1 bytes below the fresh data
@@ -205,7 +270,7 @@ HttpRequestPhase HttpRequestParser::handleBodyChunkedHeader(Slice &data)
     else
         searchOffset -= 1;
     const char *position = reinterpret_cast<const char *>(
-        Utility::find(&_chunkHeaderBuffer[searchOffset], _chunkHeaderLength - searchOffset, "\r\n", 2)
+        Utility::find(&_headerBuffer[searchOffset], _chunkHeaderLength - searchOffset, "\r\n", 2)
     );
 
     // If the CRLF is not found, the header can't be completed yet
@@ -222,16 +287,17 @@ HttpRequestPhase HttpRequestParser::handleBodyChunkedHeader(Slice &data)
         // More data is required to complete the header
         return HTTP_REQUEST_BODY_CHUNKED_HEADER;
     }
-    size_t headerEndOffset = position - _chunkHeaderBuffer;
+    size_t headerEndOffset = position - _headerBuffer;
 
     // The header was completed, parse it
-    if (!parseChunkHeader(Slice(_chunkHeaderBuffer, headerEndOffset)))
+    if (!parseChunkHeader(Slice(_headerBuffer, headerEndOffset)))
         return HTTP_REQUEST_MALFORMED;
 
     // Only consume the header part (including the double-CRLF) of the data slice
     size_t remainder = _chunkHeaderLength - (headerEndOffset + 2) + data.getLength() - copyLength;
     data.consumeStart(data.getLength() - remainder);
     _chunkHeaderLength = 0;
+    releaseBuffer();
 
     // If the chunk size is zero, expect a CRLF and complete the request
     if (_bodyRemainder == 0)
@@ -243,6 +309,53 @@ HttpRequestPhase HttpRequestParser::handleBodyChunkedHeader(Slice &data)
     return HTTP_REQUEST_BODY_CHUNKED_BODY;
 }
 
+/* Decodes as many complete chunk frames as the data holds without copying their headers, returns
+   `HTTP_REQUEST_BODY_CHUNKED_HEADER` with the data left unconsumed if a chunk header is cut off */
+HttpRequestPhase HttpRequestParser::decodeChunkFrames(Slice &data)
+{
+    while (data.getLength() > 0)
+    {
+        // Find the end of the chunk header, leaving incomplete headers to the buffered path
+        size_t searchLength = data.getLength();
+        if (searchLength > HTTP_REQUEST_BODY_CHUNKED_HEADER_MAX_LENGTH)
+            searchLength = HTTP_REQUEST_BODY_CHUNKED_HEADER_MAX_LENGTH;
+        const char *position = reinterpret_cast<const char *>(Utility::find(&data[0], searchLength, "\r\n", 2));
+        if (position == NULL)
+        {
+            if (searchLength == HTTP_REQUEST_BODY_CHUNKED_HEADER_MAX_LENGTH)
+                return HTTP_REQUEST_MALFORMED;
+            return HTTP_REQUEST_BODY_CHUNKED_HEADER;
+        }
+        size_t headerLength = position - &data[0];
+        if (!parseChunkHeader(Slice(&data[0], headerLength)))
+            return HTTP_REQUEST_MALFORMED;
+        data.consumeStart(headerLength + 2);
+
+        // The last chunk is followed by a CRLF which completes the request
+        if (_bodyRemainder == 0)
+        {
+            _isEndChunk = true;
+            return handleBodyChunkedCR(data);
+        }
+
+        // Leave chunks which are cut off to the body phase
+        if (data.getLength() < _bodyRemainder || data.getLength() - _bodyRemainder < 2)
+            return HTTP_REQUEST_BODY_CHUNKED_BODY;
+
+        // Copy the whole chunk and expect its trailing CRLF
+        size_t oldLength = _request.body.size();
+        if (_bodyRemainder > _config.maxBodySize || oldLength > _config.maxBodySize - _bodyRemainder)
+            return HTTP_REQUEST_BODY_EXCEED;
+        if (data[_bodyRemainder] != '\r' || data[_bodyRemainder + 1] != '\n')
+            return HTTP_REQUEST_MALFORMED;
+        const uint8_t *chunk = reinterpret_cast<const uint8_t *>(&data[0]);
+        _request.body.insert(_request.body.end(), chunk, chunk + _bodyRemainder);
+        data.consumeStart(_bodyRemainder + 2);
+        _bodyRemainder = 0;
+    }
+    return HTTP_REQUEST_BODY_CHUNKED_HEADER;
+}
+
 /* Handles a data commit in the `HTTP_REQUEST_BODY_CHUNKED_BODY` phase */
 HttpRequestPhase HttpRequestParser::handleBodyChunkedBody(Slice &data)
 {
@@ -282,7 +395,7 @@ HttpRequestPhase HttpRequestParser::handleBodyChunkedCR(Slice &data)
         return HTTP_REQUEST_BODY_CHUNKED_CR;
     if (!data.consumeStart(C_SLICE("\r")))
         return HTTP_REQUEST_MALFORMED;
-    return HTTP_REQUEST_BODY_CHUNKED_LF;
+    return handleBodyChunkedLF(data);
 }
 
 /* Handles a data commit in the `HTTP_REQUEST_BODY_CHUNKED_LF` phase */
@@ -308,6 +421,9 @@ bool HttpRequestParser::parseHeader(Slice data)
     Slice queryPathSlice;
     Slice versionSlice;
 
+    // Keep the header in the request's arena, all slices of the request refer to this copy
+    data = _arena.copy(data);
+
     // Expect a valid HTTP method in the first field of the request line
     if (!data.splitStart(' ', methodSlice))
         return false;
@@ -317,25 +433,30 @@ bool HttpRequestParser::parseHeader(Slice data)
     // Expect a query in the second field of the request line
     if (!data.splitStart(' ', querySlice))
         return false;
-    _request.query = querySlice.toString();
+    _request.query = querySlice;
 
     // Separate query path and parameters (if possible)
     if (querySlice.splitStart('?', queryPathSlice))
     {
-        // The path was separated, decode it into `queryPath`
-        if (!Utility::decodeUrl(queryPathSlice, _request.queryPath))
-            return false;
-        // Store the remainder as query parameters
+        // The path was separated, store the remainder as query parameters
         _request.queryParameters = querySlice;
     }
     else
     {
         // Nothing was split, the whole query is the path
-        if (!Utility::decodeUrl(querySlice, _request.queryPath))
-            return false;
+        queryPathSlice = querySlice;
         _request.queryParameters = Slice();
     }
 
+    // Decode and normalize the path into `queryPath`, which is never longer than the encoded path;
+    // paths that leave the root are rejected here, so every later lookup sees the canonical path
+    char  *queryPath = _arena.allocateArray<char>(queryPathSlice.getLength() + 1);
+    size_t queryPathLength;
+    if (!Utility::normalizePath(queryPathSlice, queryPath, queryPathLength))
+        return false;
+    queryPath[queryPathLength] = '\0';
+    _request.queryPath = Slice(queryPath, queryPathLength);
+
     // Expect HTTP 1.0 or 1.1 in the third field of the request line
     if (data.consumeStart(C_SLICE("HTTP/1.1")))
         _request.isLegacy = false;
@@ -348,6 +469,17 @@ bool HttpRequestParser::parseHeader(Slice data)
     if (data.getLength() > 0 && !data.consumeStart(C_SLICE("\r\n")))
         return false;
 
+    // Every header field takes a line of its own, so the number of lines bounds the number of fields
+    size_t lineCount = 1;
+    for (size_t index = 0; index < data.getLength(); index++)
+    {
+        if (data[index] == '\n')
+            lineCount++;
+    }
+    HttpRequest::Header *headers = _arena.allocateArray<HttpRequest::Header>(lineCount);
+    _request.headers = headers;
+    _request.headerCount = 0;
+
     // Parse and collect header fields
     while (data.getLength() > 0)
     {
@@ -362,9 +494,7 @@ bool HttpRequestParser::parseHeader(Slice data)
             data = Slice();
         }
 
-        _request.headers.push_back(
-            HttpRequest::Header(headerName.toString(), headerValue.toString())
-        );
+        new (&headers[_request.headerCount++]) HttpRequest::Header(headerName, headerValue);
     }
 
     return true;
@@ -2,11 +2,12 @@
 #define HTTP_REQUEST_PARSER_hpp
 
 #include "config.hpp"
+#include "arena.hpp"
+#include "buffer_pool.hpp"
 #include "http_request.hpp"
 
 #include <stdexcept>
 
-#define HTTP_REQUEST_HEADER_MAX_LENGTH 8192
 #define HTTP_REQUEST_BODY_CHUNKED_HEADER_MAX_LENGTH 256
 
 enum HttpRequestPhase
@@ -29,10 +30,16 @@ enum HttpRequestPhase
 class HttpRequestParser
 {
 public:
-    /* Constructs a HTTP request parser using the given rules */
-    HttpRequestParser(const ServerConfig &config, uint32_t host, uint16_t port);
+    /* Constructs a HTTP request parser using the given rules, header buffers are taken from the pool
+       and only headers which overflow them borrow one from the large pool; the request's data is
+       allocated from the arena */
+    HttpRequestParser(const ServerConfig &config, uint32_t host, uint16_t port, BufferPool &pool,
+                      BufferPool &largePool, Arena &arena);
 
-    /* Prepares the parser to consume the next request */
+    /* Returns the parser's buffer to the pool */
+    ~HttpRequestParser();
+
+    /* Prepares the parser to consume the next request, which invalidates the arena's allocations */
     void reset();
 
     /* Commits data to the parser, returns whether the parser has transitioned into a final phase */
@@ -44,6 +51,20 @@ public:
         return _phase;
     }
 
+    /* Gets whether the request's header has been parsed */
+    inline bool hasRequestHeader() const
+    {
+        return _phase != HTTP_REQUEST_HEADER && _phase != HTTP_REQUEST_HEADER_EXCEED && _phase != HTTP_REQUEST_MALFORMED;
+    }
+
+    /* Gets the request while its body is still being received; only valid after the header was parsed */
+    inline const HttpRequest &getRequestHeader() const
+    {
+        if (!hasRequestHeader())
+            throw std::runtime_error("Attempt to access incomplete or malformed request header");
+        return _request;
+    }
+
     /* Gets the built request; only valid when the current phase is `HTTP_REQUEST_COMPLETED` */
     inline const HttpRequest &getRequest() const
     {
@@ -51,19 +72,39 @@ public:
             throw std::runtime_error("Attempt to access incomplete or malformed request");
         return _request;
     }
+
+    /* Moves the built request's body into the given vector; only valid when the current phase is `HTTP_REQUEST_COMPLETED` */
+    inline void takeBody(std::vector<uint8_t> &outBody)
+    {
+        if (_phase != HTTP_REQUEST_COMPLETED)
+            throw std::runtime_error("Attempt to access incomplete or malformed request");
+        _request.body.swap(outBody);
+    }
 private:
     const ServerConfig &_config;
     uint32_t            _host;
     uint16_t            _port;
     HttpRequest         _request;
     HttpRequestPhase    _phase;
-    char                _headerBuffer[HTTP_REQUEST_HEADER_MAX_LENGTH];
+    BufferPool         &_pool;
+    BufferPool         &_largePool;
+    Arena              &_arena;
+    char               *_headerBuffer; // Only acquired while a partial (chunk) header is buffered
+    bool                _isLargeBuffer;
     size_t              _headerLength;
     size_t              _bodyRemainder;
-    char                _chunkHeaderBuffer[HTTP_REQUEST_BODY_CHUNKED_HEADER_MAX_LENGTH];
     size_t              _chunkHeaderLength;
     bool                _isEndChunk;
 
+    /* Takes a header buffer out of the pool unless the parser holds one already */
+    void acquireBuffer();
+
+    /* Returns the header buffer to the pool */
+    void releaseBuffer();
+
+    /* Moves the buffered header into a buffer of the large pool, returns false if none may be borrowed */
+    bool growBuffer();
+
     /* Handles a data commit in the `HTTP_REQUEST_HEADER` phase */
     HttpRequestPhase handleHeader(Slice &data);
 
@@ -73,6 +114,10 @@ private:
     /* Handles a data commit in the `HTTP_REQUEST_BODY_CHUNKED_HEADER` phase */
     HttpRequestPhase handleBodyChunkedHeader(Slice &data);
 
+    /* Decodes as many complete chunk frames as the data holds without copying their headers, returns
+       `HTTP_REQUEST_BODY_CHUNKED_HEADER` with the data left unconsumed if a chunk header is cut off */
+    HttpRequestPhase decodeChunkFrames(Slice &data);
+
     /* Handles a data commit in the `HTTP_REQUEST_BODY_CHUNKED_BODY` phase */
     HttpRequestPhase handleBodyChunkedBody(Slice &data);
 
@@ -87,6 +132,10 @@ private:
 
     /* Parses the given HTTP chunk header */
     bool parseChunkHeader(Slice data);
+
+    /* Disable copy-construction and copy-assignment */
+    HttpRequestParser(const HttpRequestParser &other);
+    HttpRequestParser &operator=(const HttpRequestParser &other);
 };
 
 #endif // HTTP_REQUEST_PARSER_hpp
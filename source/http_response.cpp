@@ -1,32 +1,93 @@
 #include "utility.hpp"
 #include "http_response.hpp"
 #include "http_exception.hpp"
+#include "compression.hpp"
+#include "timeout.hpp"
 
+#include <cerrno>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sstream>
 #include <unistd.h>
 #include <stdexcept>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <sys/socket.h>
+#include <sys/sendfile.h>
 
-/* Constructs an uninitialized HTTP response */
-HttpResponse::HttpResponse()
+/* Maximum number of bytes handed to a single `sendfile()` call */
+#define SENDFILE_CHUNK_SIZE (1024 * 1024)
+
+/* Constructs a body part holding literal data */
+HttpResponse::BodyPart::BodyPart(const std::string &data)
+    : data(data)
+    , offset(0)
+    , length(data.size())
+{
+}
+
+/* Constructs a body part holding a range of the file */
+HttpResponse::BodyPart::BodyPart(size_t offset, size_t length)
+    : offset(offset)
+    , length(length)
+{
+}
+
+/* Constructs an uninitialized HTTP response, the header buffer is taken from the pool */
+HttpResponse::HttpResponse(BufferPool &pool)
     : _state(HTTP_RESPONSE_UNINITIALIZED)
+    , _statusCode(0)
+    , _pool(pool)
+    , _buffer(NULL)
+    , _sharedBody(NULL)
+#ifdef __42_LIKES_WASTING_CPU_CYCLES__
+    , _bodyStream(NULL)
+#else
+    , _bodyFileno(-1)
+    , _isProbingFile(false)
+    , _isWaitingForFile(false)
+    , _wasReadAhead(false)
+#endif
+    , _hasContentEncoding(false)
+{
+    if (pool.getBufferSize() < HTTP_RESPONSE_HEADER_CAPACITY)
+        throw std::logic_error("Pooled buffers are too small for response headers");
+}
+
+/* Closes the response's file body and returns its buffer to the pool */
+HttpResponse::~HttpResponse()
 {
+    closeFileStream();
+    releaseSharedBody();
+    releaseBuffer();
 }
 
 /* Initializes the response object with an owned string */
 void HttpResponse::initializeOwned(int statusCode, Slice statusMessage, const std::string &body)
 {
-    initializeHeader(statusCode, statusMessage, body.size());
+    initializeHeader(statusCode, statusMessage);
     _bodyBuffer    = body;
     _bodySlice     = Slice(_bodyBuffer);
     _bodyRemainder = body.size();
     _state         = HTTP_RESPONSE_INITIALIZED;
 }
 
+/* Initializes the response object with a shared string as body, taking over the caller's reference */
+void HttpResponse::initializeShared(int statusCode, Slice statusMessage, SharedString *body)
+{
+    initializeHeader(statusCode, statusMessage);
+    _sharedBody    = body;
+    _bodySlice     = Slice(body->get());
+    _bodyRemainder = body->get().size();
+    _state         = HTTP_RESPONSE_INITIALIZED;
+}
+
 /* Initializes the response object with a slice of unowned memory
    NOTE: The lifetime of this slice MUST match the response's */
 void HttpResponse::initializeUnowned(int statusCode, Slice statusMessage, Slice body)
 {
-    initializeHeader(statusCode, statusMessage, body.getLength());
+    initializeHeader(statusCode, statusMessage);
     _bodySlice     = body;
     _bodyRemainder = body.getLength();
     _state = HTTP_RESPONSE_INITIALIZED;
@@ -35,23 +96,165 @@ void HttpResponse::initializeUnowned(int statusCode, Slice statusMessage, Slice
 /* Initializes the response object with a file stream of the given path */
 void HttpResponse::initializeFileStream(int statusCode, Slice statusMessage, const char *path)
 {
-    // Open the file stream at the file's end to obtain its length
-    _bodyStream.open(path, std::ios::binary | std::ios::ate);
-    if (!_bodyStream.is_open())
-        throw HttpException(500);
-    size_t length = _bodyStream.tellg();
+    initializeHeader(statusCode, statusMessage);
+    size_t length = openFileStream(path);
+    _bodyParts.assign(1, BodyPart(0, length));
+    _bodySlice     = Slice();
+    _bodyRemainder = length;
+    _state         = HTTP_RESPONSE_INITIALIZED;
+}
 
-    // Seek back to the start
-    _bodyStream.seekg(0);
-    if (!_bodyStream.good())
-        throw HttpException(500);
+/* Initializes a `206 Partial Content` response with the given ranges of the file at the given path,
+   multiple ranges are sent as `multipart/byteranges` with the given content type for each part */
+void HttpResponse::initializeFileRanges(const char *path, size_t fileSize, const std::vector<ByteRange> &ranges, Slice contentType)
+{
+    initializeHeader(206, C_SLICE("Partial Content"));
+    openFileStream(path);
+    setupFileRanges(fileSize, ranges, contentType);
+}
+
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
 
-    initializeHeader(statusCode, statusMessage, length);
+/* Initializes the response object with an opened file of the given length, taking ownership of the descriptor */
+void HttpResponse::initializeFileStream(int statusCode, Slice statusMessage, int fileno, size_t length)
+{
+    adoptFileStream(statusCode, statusMessage, fileno);
+    _bodyParts.assign(1, BodyPart(0, length));
     _bodySlice     = Slice();
     _bodyRemainder = length;
     _state         = HTTP_RESPONSE_INITIALIZED;
 }
 
+/* Initializes a `206 Partial Content` response with the given ranges of an opened file, taking ownership
+   of the descriptor; multiple ranges are sent as `multipart/byteranges` */
+void HttpResponse::initializeFileRanges(int fileno, size_t fileSize, const std::vector<ByteRange> &ranges, Slice contentType)
+{
+    adoptFileStream(206, C_SLICE("Partial Content"), fileno);
+    setupFileRanges(fileSize, ranges, contentType);
+}
+
+/* Initializes the header and takes ownership of the opened file, which is closed if that fails */
+void HttpResponse::adoptFileStream(int statusCode, Slice statusMessage, int fileno)
+{
+    try
+    {
+        initializeHeader(statusCode, statusMessage);
+    }
+    catch (...)
+    {
+        close(fileno);
+        throw;
+    }
+    _bodyFileno    = fileno;
+    _bodyPartIndex = 0;
+    adviseFileStream();
+}
+
+/* Lets the kernel read ahead the opened file and starts checking whether its data is cached */
+void HttpResponse::adviseFileStream()
+{
+    // Files are sent from start to end (or range by range), which doubles the read-ahead window
+    posix_fadvise(_bodyFileno, 0, 0, POSIX_FADV_SEQUENTIAL);
+    _isProbingFile    = true;
+    _isWaitingForFile = false;
+    _wasReadAhead     = false;
+}
+
+/* Gets the file body's descriptor and the range that sending waits for */
+void HttpResponse::getColdRange(int &outFileno, size_t &outOffset, size_t &outLength) const
+{
+    if (!_isWaitingForFile)
+        throw std::logic_error("getColdRange() called on a response that is not waiting for its file");
+    const BodyPart &part = _bodyParts[_bodyPartIndex];
+    outFileno = _bodyFileno;
+    outOffset = part.offset;
+    outLength = std::min(part.length, static_cast<size_t>(SENDFILE_CHUNK_SIZE));
+}
+
+/* Continues sending once the awaited range was read into the page cache */
+void HttpResponse::resumeFile()
+{
+    _isWaitingForFile = false;
+    _wasReadAhead     = true;
+}
+
+/* Checks without blocking whether the given range of the file body is in the page cache */
+bool HttpResponse::isFileRangeCached(size_t offset, size_t length)
+{
+    // Read-ahead fills a range from its start, so probing both ends covers partially cached ranges
+    char         byte;
+    struct iovec vector;
+    vector.iov_base = &byte;
+    vector.iov_len  = 1;
+    off_t offsets[] = { static_cast<off_t>(offset), static_cast<off_t>(offset + length - 1) };
+    for (size_t index = 0; index < sizeof(offsets) / sizeof(offsets[0]); index++)
+    {
+        if (preadv2(_bodyFileno, &vector, 1, offsets[index], RWF_NOWAIT) >= 0)
+            continue;
+        if (errno == EAGAIN)
+            return false;
+
+        // Without support for the check every range is sent right away, `sendfile()` reports actual errors
+        _isProbingFile = false;
+        break;
+    }
+    return true;
+}
+
+#endif // __42_LIKES_WASTING_CPU_CYCLES__
+
+/* Lays out the body parts and header fields for the given ranges of the opened file */
+void HttpResponse::setupFileRanges(size_t fileSize, const std::vector<ByteRange> &ranges, Slice contentType)
+{
+    static unsigned int boundaryCounter = 0;
+
+    _bodyParts.clear();
+
+    if (ranges.size() == 1)
+    {
+        appendHeader(C_SLICE("Content-Type: "));
+        appendHeader(contentType);
+        appendHeader(C_SLICE("\r\nContent-Range: bytes "));
+        appendHeader(ranges[0].offset);
+        appendHeader(C_SLICE("-"));
+        appendHeader(ranges[0].offset + ranges[0].length - 1);
+        appendHeader(C_SLICE("/"));
+        appendHeader(fileSize);
+        appendHeader(C_SLICE("\r\n"));
+        _bodyParts.push_back(BodyPart(ranges[0].offset, ranges[0].length));
+        _bodyRemainder = ranges[0].length;
+    }
+    else
+    {
+        // The boundary only has to be unlikely to appear within the file
+        std::stringstream boundaryStream;
+        boundaryStream << "webserv" << std::hex << reinterpret_cast<uintptr_t>(this) << ++boundaryCounter << fileSize;
+        std::string boundary = boundaryStream.str();
+
+        // Each part is preceded by its own header, the body is closed by a final delimiter
+        _bodyRemainder = 0;
+        for (size_t index = 0; index < ranges.size(); index++)
+        {
+            std::stringstream partHeader;
+            partHeader << "\r\n--" << boundary << "\r\n"
+                       << "Content-Type: " << contentType << "\r\n"
+                       << "Content-Range: bytes " << ranges[index].offset << '-'
+                       << ranges[index].offset + ranges[index].length - 1 << '/' << fileSize << "\r\n\r\n";
+            _bodyParts.push_back(BodyPart(partHeader.str()));
+            _bodyParts.push_back(BodyPart(ranges[index].offset, ranges[index].length));
+            _bodyRemainder += _bodyParts[_bodyParts.size() - 2].length + ranges[index].length;
+        }
+        _bodyParts.push_back(BodyPart("\r\n--" + boundary + "--\r\n"));
+        _bodyRemainder += _bodyParts.back().length;
+
+        appendHeader(C_SLICE("Content-Type: multipart/byteranges; boundary="));
+        appendHeader(Slice(boundary));
+        appendHeader(C_SLICE("\r\n"));
+    }
+    _bodySlice = Slice();
+    _state     = HTTP_RESPONSE_INITIALIZED;
+}
+
 /* Initializes the response object with CGI output data
    NOTE: The lifetime of this slice MUST match the response's */
 void HttpResponse::initializeUnownedCgi(Slice response)
@@ -104,8 +307,10 @@ void HttpResponse::initializeUnownedCgi(Slice response)
         if (!value.splitStart(':', key))
             throw std::runtime_error("Invalid CGI header");
 
-        // Add the header to the response, ignoring the "Status" header
-        if (key != C_SLICE("Status"))
+        // Add the header to the response, ignoring the "Status" header, the date which is always sent
+        // and the framing of the body, which is described by the server's own `Content-Length`
+        if (key != C_SLICE("Status") && !key.equalsIgnoreCase(C_SLICE("Date"))
+         && !key.equalsIgnoreCase(C_SLICE("Content-Length")) && !key.equalsIgnoreCase(C_SLICE("Transfer-Encoding")))
         {
             value.consumeStart(C_SLICE(" "));
             addHeader(key, value);
@@ -113,32 +318,101 @@ void HttpResponse::initializeUnownedCgi(Slice response)
     }
 }
 
+/* Initializes the response object with a completely serialized response, only its header is copied
+   to replace the date it was serialized at
+   NOTE: The lifetime of this slice MUST match the response's */
+void HttpResponse::initializePrerendered(Slice response)
+{
+    // The `Date` header field directly follows the status line (see `initializeHeader()`)
+    Slice header, statusLine, dateLine;
+    if (!response.splitStart(C_SLICE("\r\n\r\n"), header) || !header.splitStart(C_SLICE("\r\n"), statusLine)
+     || !header.splitStart(C_SLICE("\r\n"), dateLine))
+        throw std::logic_error("Invalid prerendered response");
+
+    closeFileStream();
+    releaseSharedBody();
+    if (_buffer == NULL)
+        _buffer = _pool.acquire();
+    _headerLength = 0;
+    appendHeader(statusLine);
+    appendHeader(C_SLICE("\r\n"));
+    appendDateHeader();
+    appendHeader(header);
+    appendHeader(C_SLICE("\r\n\r\n"));
+    _headerSlice   = Slice(_buffer, _headerLength);
+    _bodySlice     = response;
+    _bodyRemainder = response.getLength();
+    _state         = HTTP_RESPONSE_FINALIZED;
+}
+
 /* Add a header field to the header response */
 void HttpResponse::addHeader(Slice key, Slice value)
 {
     if (_state != HTTP_RESPONSE_INITIALIZED)
         throw std::logic_error("addHeader() called on uninitialized response");
-    _headerStream << key << ": " << value << "\r\n";
+    appendHeader(key);
+    appendHeader(C_SLICE(": "));
+    appendHeader(value);
+    appendHeader(C_SLICE("\r\n"));
+
+    // Remember what is needed to decide about compression later on
+    if (key.equalsIgnoreCase(C_SLICE("Content-Type")))
+        _contentType = value.toString();
+    else if (key.equalsIgnoreCase(C_SLICE("Content-Encoding")))
+        _hasContentEncoding = true;
+}
+
+/* Checks whether the in-memory body may be compressed according to the given content types and minimum length */
+bool HttpResponse::isCompressible(const std::set<std::string> &types, size_t minLength) const
+{
+    if (_state != HTTP_RESPONSE_INITIALIZED || hasFileBody() || _hasContentEncoding)
+        return false;
+    if (_bodyRemainder < minLength)
+        return false;
+    return Compression::matchesType(types, _contentType);
+}
+
+/* Compresses the in-memory body with gzip and adds the matching `Content-Encoding` */
+void HttpResponse::compressBody()
+{
+    if (_state != HTTP_RESPONSE_INITIALIZED || hasFileBody())
+        throw std::logic_error("compressBody() called on a response without in-memory body");
+
+    // Keep the original body if compression fails for whatever reason
+    std::string compressed;
+    if (!Compression::compressGzip(_bodySlice, compressed))
+        return;
+    _bodyBuffer.swap(compressed);
+    _bodySlice     = Slice(_bodyBuffer);
+    _bodyRemainder = _bodyBuffer.size();
+    addHeader(C_SLICE("Content-Encoding"), C_SLICE("gzip"));
 }
 
 /* Finalize Header */
-uint64_t HttpResponse::finalizeHeader()
+void HttpResponse::finalizeHeader()
 {
     if (_state != HTTP_RESPONSE_INITIALIZED)
         throw std::logic_error("finalizeHeader() called on uninitialized response");
-    _headerStream << "\r\n";
-    _headerString = _headerStream.str();
-    _headerSlice = _headerString;
+
+    // The length is only known for sure once the body may no longer be compressed; responses which never
+    // have content omit it, a 304 would otherwise replace the length of the client's cached response
+    if (_statusCode >= 200 && _statusCode != 204 && _statusCode != 304)
+    {
+        appendHeader(C_SLICE("Content-Length: "));
+        appendHeader(_bodyRemainder);
+        appendHeader(C_SLICE("\r\n"));
+    }
+    appendHeader(C_SLICE("\r\n"));
+    _headerSlice = Slice(_buffer, _headerLength);
     _state = HTTP_RESPONSE_FINALIZED;
+}
 
-    // This is an approximation based on very slow network speed
-    // A GiB of data can take up to ~14 hours before the client is dropped
-    // A MiB of data can take up to ~50 seconds before the client is dropped
-    // Anything below or equal to 20 KiB is clamped up to a second
-    double timeout = static_cast<double>(this->_bodyRemainder) * 0.05;
-    if (timeout < 1000)
-        return 1000;
-    return static_cast<uint64_t>(timeout);
+/* Gets the finalized header and in-memory body as a single string */
+std::string HttpResponse::serialize() const
+{
+    if (_state != HTTP_RESPONSE_FINALIZED || hasFileBody())
+        throw std::logic_error("serialize() called on a response without finalized in-memory body");
+    return _headerSlice.toString() + _bodySlice.toString();
 }
 
 /* Check if the response has data to send */
@@ -149,74 +423,342 @@ bool HttpResponse::hasData()
     return !_headerSlice.isEmpty() || _bodyRemainder > 0;
 }
 
-// Start transfer process of the response to the socket
-void HttpResponse::transferToSocket(int fileno)
+/* Start transfer process of the response to the socket, returns the number of bytes sent;
+   keeps writing until the socket would block unless every write must wait for the next event */
+size_t HttpResponse::transferToSocket(int fileno)
 {
     if (_state != HTTP_RESPONSE_FINALIZED)
         throw std::logic_error("transferToSocket() called on non-finalized response");
 
-    // Send the header first
-    if (!_headerSlice.isEmpty())
+    size_t totalSent = 0;
+    while (hasData())
     {
-        sendSliceToSocket(fileno, _headerSlice);
-        return;
+        size_t bytesSent = sendPieceToSocket(fileno);
+        totalSent += bytesSent;
+#ifdef __42_LIKES_WASTING_CPU_CYCLES__
+        break;
+#else
+        // Stop once the socket's send buffer is full, the next EPOLLOUT continues
+        if (bytesSent == 0)
+            break;
+#endif
     }
 
-    // Send the body
-    if (_bodyRemainder > 0)
-    {
-        size_t bytesSent;
-        if (_bodyStream.is_open())
-            bytesSent = streamFileToSocket(fileno);
-        else
-            bytesSent = sendSliceToSocket(fileno, _bodySlice);
+    // The buffer is not needed anymore once everything was sent
+    if (!hasData())
+        releaseBuffer();
+    return totalSent;
+}
+
+/* Initializes the header string stream with a response line */
+void HttpResponse::initializeHeader(int statusCode, Slice statusMessage)
+{
+    // Status codes always have three digits, anything else is a bug
+    if (statusCode < 100 || statusCode > 999)
+        throw std::logic_error("Invalid status code");
+    char statusLine[] = "HTTP/1.1 000 ";
+    statusLine[9]  = '0' + statusCode / 100;
+    statusLine[10] = '0' + statusCode / 10 % 10;
+    statusLine[11] = '0' + statusCode % 10;
+
+    closeFileStream();
+    releaseSharedBody();
+    if (_buffer == NULL)
+        _buffer = _pool.acquire();
+    _headerLength = 0;
+    appendHeader(Slice(statusLine, sizeof(statusLine) - 1));
+    appendHeader(statusMessage);
+    appendHeader(C_SLICE("\r\n"));
+    appendDateHeader();
+    appendHeader(C_SLICE(HTTP_RESPONSE_STATIC_HEADERS));
+    _contentType.clear();
+    _hasContentEncoding = false;
+    _statusCode = statusCode;
+}
+
+/* Appends raw data to the header buffer */
+void HttpResponse::appendHeader(Slice data)
+{
+    if (HTTP_RESPONSE_HEADER_CAPACITY - _headerLength < data.getLength())
+        throw std::runtime_error("Response header exceeds capacity");
+    if (data.isEmpty())
+        return;
+    std::memcpy(&_buffer[_headerLength], &data[0], data.getLength());
+    _headerLength += data.getLength();
+}
+
+/* Appends the `Date` header field, which is rendered at most once per second and shared by all responses */
+void HttpResponse::appendDateHeader()
+{
+    static time_t      renderedDate = -1;
+    static std::string dateHeader;
 
-        // Reduce the number of remaining bytes but check for underflow first
-        if (bytesSent > _bodyRemainder)
-            bytesSent = _bodyRemainder;
-        _bodyRemainder -= bytesSent;
+    time_t currentDate = Timeout::getCurrentDate();
+    if (currentDate != renderedDate)
+    {
+        dateHeader = "Date: " + Utility::formatHttpDate(currentDate) + "\r\n";
+        renderedDate = currentDate;
     }
+    appendHeader(dateHeader);
 }
 
-/* Initializes the header string stream with a response line */
-void HttpResponse::initializeHeader(int statusCode, Slice statusMessage, size_t bodySize)
+/* Returns the buffer to the pool */
+void HttpResponse::releaseBuffer()
+{
+    if (_buffer != NULL)
+        _pool.release(_buffer);
+    _buffer = NULL;
+}
+
+/* Releases the reference to the shared body if there is one */
+void HttpResponse::releaseSharedBody()
 {
-    _headerStream.clear();
-    _headerStream << "HTTP/1.1 " << statusCode << ' ' << statusMessage << "\r\n"
-                  << "Content-Length: " << bodySize << "\r\n"
-                  << "Connection: close\r\n";
+    if (_sharedBody != NULL)
+        _sharedBody->release();
+    _sharedBody = NULL;
 }
 
-/* Attempts to send as many bytes as possible from a slice to a socket,
-   only consumes the bytes that were actually sent */
-size_t HttpResponse::sendSliceToSocket(int fileno, Slice &slice)
+/* Appends a decimal number to the header buffer */
+void HttpResponse::appendHeader(size_t number)
 {
-    ssize_t result;
+    char buffer[UTILITY_SIZE_DIGITS];
+    appendHeader(Slice(buffer, Utility::formatSize(number, buffer)));
+}
 
-    result = send(fileno, &slice[0], slice.getLength(), MSG_DONTWAIT);
+/* Sends the next piece of the response, returns the number of bytes sent
+   or zero if the socket would block */
+size_t HttpResponse::sendPieceToSocket(int fileno)
+{
+    // An in-memory body is coalesced with the header into a single call
+    if (!hasFileBody())
+    {
+        size_t bodyLength = _bodySlice.getLength();
+        size_t bytesSent = sendSlicesToSocket(fileno, _headerSlice, _bodySlice, 0);
+        size_t bodySent = bodyLength - _bodySlice.getLength();
+        _bodyRemainder -= std::min(bodySent, _bodyRemainder);
+        return bytesSent;
+    }
+
+    // The header of a file body is held back until the first part of the file fills the packet
+    if (!_headerSlice.isEmpty())
+    {
+        Slice empty;
+#ifdef __42_LIKES_WASTING_CPU_CYCLES__
+        return sendSlicesToSocket(fileno, _headerSlice, empty, 0);
+#else
+        return sendSlicesToSocket(fileno, _headerSlice, empty, _bodyRemainder > 0 ? MSG_MORE : 0);
+#endif
+    }
+
+    // Reduce the number of remaining bytes but check for underflow first
+    size_t bytesSent = streamFileToSocket(fileno);
+    _bodyRemainder -= std::min(bytesSent, _bodyRemainder);
+    return bytesSent;
+}
+
+/* Attempts to send as many bytes as possible from two slices to a socket with a single call,
+   only consumes the bytes that were actually sent; returns zero if the socket would block */
+size_t HttpResponse::sendSlicesToSocket(int fileno, Slice &first, Slice &second, int flags)
+{
+    struct iovec  vectors[2];
+    struct msghdr message;
+    size_t        vectorCount = 0;
+
+    if (!first.isEmpty())
+    {
+        vectors[vectorCount].iov_base = const_cast<char *>(&first[0]);
+        vectors[vectorCount].iov_len  = first.getLength();
+        vectorCount++;
+    }
+    if (!second.isEmpty())
+    {
+        vectors[vectorCount].iov_base = const_cast<char *>(&second[0]);
+        vectors[vectorCount].iov_len  = second.getLength();
+        vectorCount++;
+    }
+    if (vectorCount == 0)
+        return 0;
+
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov    = vectors;
+    message.msg_iovlen = vectorCount;
+    ssize_t result = sendmsg(fileno, &message, MSG_DONTWAIT | MSG_NOSIGNAL | flags);
     if (result == -1)
+    {
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return 0;
+#endif
         throw std::runtime_error("Unable to send data to socket");
+    }
     if (result == 0)
         throw std::runtime_error("Remote host has closed the connection");
 
+    // Consume the sent bytes from the first slice before the second
     size_t bytesSent = static_cast<size_t>(result);
-    slice.consumeStart(bytesSent);
+    size_t firstSent = std::min(bytesSent, first.getLength());
+    first.consumeStart(firstSent);
+    second.consumeStart(bytesSent - firstSent);
     return bytesSent;
 }
 
+#ifdef __42_LIKES_WASTING_CPU_CYCLES__
 
-/* Buffers and streams bytes out of `_bodyFileno` to the given socket */
+/* Opens the file stream of the given path, returns the file's length */
+size_t HttpResponse::openFileStream(const char *path)
+{
+    // Open the file stream at the file's end to obtain its length
+    closeFileStream();
+    _bodyStream = new std::ifstream(path, std::ios::binary | std::ios::ate);
+    if (!_bodyStream->is_open())
+    {
+        closeFileStream();
+        throw HttpException(500);
+    }
+    size_t length = _bodyStream->tellg();
+
+    // Seek back to the start
+    _bodyStream->seekg(0);
+    if (!_bodyStream->good())
+    {
+        closeFileStream();
+        throw HttpException(500);
+    }
+    _bodyPartIndex = 0;
+    _streamOffset  = 0;
+    return length;
+}
+
+/* Closes the file stream if one is open */
+void HttpResponse::closeFileStream()
+{
+    delete _bodyStream;
+    _bodyStream = NULL;
+}
+
+/* Sends the next piece of the file body to the given socket, returns zero if the socket would block */
 size_t HttpResponse::streamFileToSocket(int fileno)
 {
-    if (_bodySlice.isEmpty())
+    while (_bodySlice.isEmpty())
     {
-        _bodyStream.read(_readBuffer, sizeof(_readBuffer));
-        if (_bodyStream.bad())
+        if (_bodyPartIndex == _bodyParts.size())
+            throw std::runtime_error("Unexpected end of body");
+        BodyPart &part = _bodyParts[_bodyPartIndex];
+
+        // Literal parts are sent as they are
+        if (!part.data.empty())
+        {
+            _bodySlice = Slice(part.data);
+            _bodyPartIndex++;
+            break;
+        }
+        if (part.length == 0)
+        {
+            _bodyPartIndex++;
+            continue;
+        }
+
+        // Only seek when the range does not continue where the last read stopped
+        if (_streamOffset != part.offset)
+        {
+            _bodyStream->seekg(part.offset);
+            _streamOffset = part.offset;
+        }
+        // The header was sent already, so its buffer is reused for reading
+        size_t readLength = _pool.getBufferSize();
+        if (readLength > part.length)
+            readLength = part.length;
+        _bodyStream->read(_buffer, readLength);
+        if (_bodyStream->bad())
             throw std::runtime_error("Unable to read file");
-        size_t bytesRead = _bodyStream.gcount();
+        size_t bytesRead = _bodyStream->gcount();
         if (bytesRead == 0)
             throw std::runtime_error("Unexpected end of file");
-        _bodySlice = Slice(_readBuffer, bytesRead);
+        _bodySlice = Slice(_buffer, bytesRead);
+        _streamOffset += bytesRead;
+        part.offset += bytesRead;
+        part.length -= bytesRead;
+    }
+    Slice empty;
+    return sendSlicesToSocket(fileno, _bodySlice, empty, 0);
+}
+
+#else
+
+/* Opens the file stream of the given path, returns the file's length */
+size_t HttpResponse::openFileStream(const char *path)
+{
+    closeFileStream();
+    _bodyFileno = open(path, O_RDONLY | O_CLOEXEC);
+    if (_bodyFileno < 0)
+        throw HttpException(500);
+
+    // The descriptor's size matches the data that is actually sent, even if the path was replaced meanwhile
+    struct stat status;
+    if (fstat(_bodyFileno, &status) < 0 || !S_ISREG(status.st_mode))
+    {
+        closeFileStream();
+        throw HttpException(500);
+    }
+    _bodyPartIndex = 0;
+    adviseFileStream();
+    return status.st_size;
+}
+
+/* Closes the file stream if one is open */
+void HttpResponse::closeFileStream()
+{
+    if (_bodyFileno >= 0)
+        close(_bodyFileno);
+    _bodyFileno       = -1;
+    _isWaitingForFile = false;
+}
+
+/* Sends the next piece of the file body to the given socket, returns zero if the socket would block */
+size_t HttpResponse::streamFileToSocket(int fileno)
+{
+    while (_bodyPartIndex < _bodyParts.size() && _bodyParts[_bodyPartIndex].length == 0)
+        _bodyPartIndex++;
+    if (_bodyPartIndex == _bodyParts.size())
+        throw std::runtime_error("Unexpected end of body");
+    BodyPart &part = _bodyParts[_bodyPartIndex];
+
+    // Literal parts are corked onto the following file range, only the closing delimiter flushes
+    if (!part.data.empty())
+    {
+        Slice data = Slice(part.data);
+        data.consumeStart(part.data.size() - part.length);
+        Slice empty;
+        bool isLast = _bodyPartIndex + 1 == _bodyParts.size();
+        size_t bytesSent = sendSlicesToSocket(fileno, data, empty, isLast ? 0 : MSG_MORE);
+        part.length -= bytesSent;
+        return bytesSent;
+    }
+
+    // Ranges which are not cached yet are read ahead off the event loop (see `getColdRange()`),
+    // so that only this response waits for the disk
+    size_t length = std::min(part.length, static_cast<size_t>(SENDFILE_CHUNK_SIZE));
+    if (_isProbingFile && !_wasReadAhead && !isFileRangeCached(part.offset, length))
+    {
+        _isWaitingForFile = true;
+        return 0;
     }
-    return sendSliceToSocket(fileno, _bodySlice);
+    _wasReadAhead = false;
+
+    // File ranges are copied by the kernel without passing through user space
+    off_t offset = part.offset;
+    ssize_t result = sendfile(fileno, _bodyFileno, &offset, length);
+    if (result == -1)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return 0;
+        throw std::runtime_error("Unable to send file to socket");
+    }
+    if (result == 0)
+        throw std::runtime_error("Unexpected end of file");
+    part.offset += result;
+    part.length -= result;
+    return result;
 }
+
+#endif
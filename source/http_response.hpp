@@ -1,13 +1,23 @@
 #ifndef HTTP_RESPONSE_hpp
 #define HTTP_RESPONSE_hpp
 
+#include <set>
 #include <string>
+#include <vector>
 #include <fstream>
-#include <sstream>
 #include <unistd.h>
 #include <stdint.h>
 
 #include "slice.hpp"
+#include "byte_range.hpp"
+#include "buffer_pool.hpp"
+#include "shared_string.hpp"
+
+/* Maximum size of a response header, including the CGI's header fields */
+#define HTTP_RESPONSE_HEADER_CAPACITY 8192
+
+/* Header fields sent with every response */
+#define HTTP_RESPONSE_STATIC_HEADERS "Connection: close\r\nServer: webserv\r\n"
 
 enum HttpResponseState
 {
@@ -19,8 +29,11 @@ enum HttpResponseState
 class HttpResponse
 {
 public:
-    /* Constructs an uninitialized HTTP response */
-    HttpResponse();
+    /* Constructs an uninitialized HTTP response, the header buffer is taken from the pool */
+    explicit HttpResponse(BufferPool &pool);
+
+    /* Closes the response's file body and returns its buffer to the pool */
+    ~HttpResponse();
 
     /* Initializes the response object with an empty body */
     inline void initializeEmpty(int statusCode, Slice statusMessage)
@@ -31,6 +44,9 @@ public:
     /* Initializes the response object with an owned string as body */
     void initializeOwned(int statusCode, Slice statusMessage, const std::string &body);
 
+    /* Initializes the response object with a shared string as body, taking over the caller's reference */
+    void initializeShared(int statusCode, Slice statusMessage, SharedString *body);
+
     /* Initializes the response object with a slice of unowned memory as body
        NOTE: The lifetime of this slice MUST match the response's */
     void initializeUnowned(int statusCode, Slice statusMessage, Slice body);
@@ -38,21 +54,61 @@ public:
     /* Initializes the response object with a file stream of the given path */
     void initializeFileStream(int statusCode, Slice statusMessage, const char *path);
 
+    /* Initializes a `206 Partial Content` response with the given ranges of the file at the given path,
+       multiple ranges are sent as `multipart/byteranges` with the given content type for each part */
+    void initializeFileRanges(const char *path, size_t fileSize, const std::vector<ByteRange> &ranges, Slice contentType);
+
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+    /* Initializes the response object with an opened file of the given length, taking ownership of the descriptor */
+    void initializeFileStream(int statusCode, Slice statusMessage, int fileno, size_t length);
+
+    /* Initializes a `206 Partial Content` response with the given ranges of an opened file, taking ownership
+       of the descriptor; multiple ranges are sent as `multipart/byteranges` */
+    void initializeFileRanges(int fileno, size_t fileSize, const std::vector<ByteRange> &ranges, Slice contentType);
+
+    /* Gets whether sending stopped because the next range of the file body is not in the page cache */
+    inline bool isWaitingForFile() const
+    {
+        return _isWaitingForFile;
+    }
+
+    /* Gets the file body's descriptor and the range that sending waits for */
+    void getColdRange(int &outFileno, size_t &outOffset, size_t &outLength) const;
+
+    /* Continues sending once the awaited range was read into the page cache */
+    void resumeFile();
+#endif
+
     /* Initializes the response object with CGI output data
        NOTE: The lifetime of this slice MUST match the response's */
     void initializeUnownedCgi(Slice response);
 
+    /* Initializes the response object with a completely serialized response, only its header is copied
+       to replace the date it was serialized at
+       NOTE: The lifetime of this slice MUST match the response's */
+    void initializePrerendered(Slice response);
+
     /* Add a header field to the header response */
     void addHeader(Slice key, Slice value);
 
+    /* Checks whether the in-memory body may be compressed according to the given content types and minimum length */
+    bool isCompressible(const std::set<std::string> &types, size_t minLength) const;
+
+    /* Compresses the in-memory body with gzip and adds the matching `Content-Encoding` */
+    void compressBody();
+
     /* Finalize Header */
-    uint64_t finalizeHeader();
+    void finalizeHeader();
+
+    /* Gets the finalized header and in-memory body as a single string */
+    std::string serialize() const;
 
     /* Check if the response has data to send */
     bool hasData();
 
-    /* Start transfer process of the response to the socket */
-    void transferToSocket(int fileno);
+    /* Start transfer process of the response to the socket, returns the number of bytes sent;
+       keeps writing until the socket would block unless every write must wait for the next event */
+    size_t transferToSocket(int fileno);
 
     /* Gets the response's current state */
     inline HttpResponseState getState() const
@@ -60,25 +116,106 @@ public:
         return _state;
     }
 private:
-    HttpResponseState _state;
-    std::stringstream _headerStream;
-    std::string       _headerString;
-    std::string       _bodyBuffer;
-    Slice             _headerSlice;
-    Slice             _bodySlice;
-    std::ifstream     _bodyStream;
-    size_t            _bodyRemainder;
-    char              _readBuffer[8192];
+    /* Part of a file stream body, either literal data or a range of the file */
+    struct BodyPart
+    {
+        std::string data;
+        size_t      offset;
+        size_t      length;
+
+        /* Constructs a body part holding literal data */
+        BodyPart(const std::string &data);
+
+        /* Constructs a body part holding a range of the file */
+        BodyPart(size_t offset, size_t length);
+    };
+
+    HttpResponseState     _state;
+    int                   _statusCode;
+    BufferPool           &_pool;
+    char                 *_buffer; // Holds the header until it is sent, only acquired while needed
+    size_t                _headerLength;
+    std::string           _bodyBuffer;
+    SharedString         *_sharedBody;
+    Slice                 _headerSlice;
+    Slice                 _bodySlice;
+    size_t                _bodyRemainder;
+    std::vector<BodyPart> _bodyParts;
+    size_t                _bodyPartIndex;
+#ifdef __42_LIKES_WASTING_CPU_CYCLES__
+    std::ifstream        *_bodyStream;       // Only allocated while a file body is sent
+    size_t                _streamOffset;
+#else
+    int                   _bodyFileno;
+    bool                  _isProbingFile;    // Cleared if the file system can not tell whether data is cached
+    bool                  _isWaitingForFile;
+    bool                  _wasReadAhead;     // The next range was just read, it is sent even if it is not cached
+#endif
+    std::string           _contentType;
+    bool                  _hasContentEncoding;
+
+    /* Opens the file stream of the given path, returns the file's length */
+    size_t openFileStream(const char *path);
+
+    /* Closes the file stream if one is open */
+    void closeFileStream();
+
+    /* Releases the reference to the shared body if there is one */
+    void releaseSharedBody();
+
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+    /* Initializes the header and takes ownership of the opened file, which is closed if that fails */
+    void adoptFileStream(int statusCode, Slice statusMessage, int fileno);
+
+    /* Lets the kernel read ahead the opened file and starts checking whether its data is cached */
+    void adviseFileStream();
+
+    /* Checks without blocking whether the given range of the file body is in the page cache */
+    bool isFileRangeCached(size_t offset, size_t length);
+#endif
+
+    /* Lays out the body parts and header fields for the given ranges of the opened file */
+    void setupFileRanges(size_t fileSize, const std::vector<ByteRange> &ranges, Slice contentType);
+
+    /* Returns the buffer to the pool */
+    void releaseBuffer();
+
+    /* Appends the `Date` header field, which is rendered at most once per second and shared by all responses */
+    void appendDateHeader();
+
+    /* Checks whether the body is read from a file */
+    inline bool hasFileBody() const
+    {
+#ifdef __42_LIKES_WASTING_CPU_CYCLES__
+        return _bodyStream != NULL;
+#else
+        return _bodyFileno >= 0;
+#endif
+    }
 
     /* Initializes the header string stream with a response line */
-    void initializeHeader(int statusCode, Slice statusMessage, size_t bodySize);
+    void initializeHeader(int statusCode, Slice statusMessage);
+
+    /* Appends raw data to the header buffer */
+    void appendHeader(Slice data);
 
-    /* Attempts to send as many bytes as possible from a slice to a socket,
-       only consumes the bytes that were actually sent */
-    size_t sendSliceToSocket(int fileno, Slice &slice);
+    /* Appends a decimal number to the header buffer */
+    void appendHeader(size_t number);
 
-    /* Buffers and streams bytes out of `_bodyFileno` to the given socket */
+    /* Sends the next piece of the response, returns the number of bytes sent
+       or zero if the socket would block */
+    size_t sendPieceToSocket(int fileno);
+
+    /* Attempts to send as many bytes as possible from two slices to a socket with a single call,
+       only consumes the bytes that were actually sent; returns zero if the socket would block */
+    size_t sendSlicesToSocket(int fileno, Slice &first, Slice &second, int flags);
+
+    /* Sends the next piece of the file body to the given socket, returns zero if the socket would block */
     size_t streamFileToSocket(int fileno);
+
+    /* Disable copy-construction and copy-assignment */
+    HttpResponse(const HttpResponse &other);
+    HttpResponse &operator=(const HttpResponse &other);
 };
 
 #endif // HTTP_RESPONSE_hpp
@@ -1,15 +1,37 @@
 #include "application.hpp"
 #include "http_server.hpp"
 
+#include <errno.h>
 #include <unistd.h>
 #include <arpa/inet.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
 
-/* Constructs an HTTP server according to its configuration */
-HttpServer::HttpServer(Application &application, const ServerConfig &config)
+/* Response sent to clients that are rejected because no file descriptors are left */
+static const char g_unavailableResponse[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Content-Length: 0\r\n"
+    "Connection: close\r\n"
+    "\r\n";
+
+/* Constructs an HTTP server according to its configuration, adopting the given listening
+   socket instead of binding a new one if it is valid (eg. inherited during a binary upgrade) */
+HttpServer::HttpServer(Application &application, const ServerConfig &config, int inheritedFileno)
     : _application(application)
     , _config(config)
+    , _clientCount(0)
+    , _isAccepting(false)
+    , _isAtConnectionLimit(false)
+    , _headerPool(config.headerBufferSize)
+    , _largeHeaderPool(config.largeHeaderBufferSize)
 {
+    // The inherited socket is already bound and listening, its backlog was never closed
+    if (inheritedFileno >= 0)
+    {
+        _fileno = inheritedFileno;
+        return;
+    }
+
     if ((_fileno = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0)
         throw std::runtime_error("Unable to create TCP listener socket");
 
@@ -45,7 +67,7 @@ HttpServer::~HttpServer()
 /* Handles one or multiple events */
 void HttpServer::handleEvents(uint32_t eventMask)
 {
-    if ((eventMask & EPOLLIN) == 0)
+    if ((eventMask & EPOLLIN) == 0 || !_isAccepting)
         return;
 
     int         fileno;
@@ -53,11 +75,22 @@ void HttpServer::handleEvents(uint32_t eventMask)
     socklen_t   addressLength = sizeof(address);
 
     if ((fileno = accept(_fileno, (sockaddr *)&address, &addressLength)) < 0)
+    {
+        // The connection may have been reset before it could be accepted
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNABORTED || errno == EINTR)
+            return;
+        // Without file descriptors, the listener would stay readable and spin the event loop
+        if (errno == EMFILE || errno == ENFILE)
+        {
+            rejectClient();
+            return;
+        }
         throw std::runtime_error("Unable to accept client");
+    }
 
     try
     {
-        _application.takeClient(fileno, _config, ntohl(address.sin_addr.s_addr), ntohs(address.sin_port));
+        _application.takeClient(fileno, *this, ntohl(address.sin_addr.s_addr), ntohs(address.sin_port));
     }
     catch (...)
     {
@@ -71,3 +104,47 @@ void HttpServer::handleException(const char *message)
 {
     (void)message;
 }
+
+/* Gets the number of connections waiting to be accepted; returns 0 if not supported */
+size_t HttpServer::getAcceptQueueDepth()
+{
+    tcp_info  info;
+    socklen_t infoLength = sizeof(info);
+
+    // For listening sockets, the kernel reports the accept queue's length as unacknowledged segments
+    if (getsockopt(_fileno, IPPROTO_TCP, TCP_INFO, &info, &infoLength) != 0)
+        return 0;
+    return info.tcpi_unacked;
+}
+
+/* Starts or stops receiving new connections; pending ones queue up in the kernel backlog */
+void HttpServer::setAccepting(bool isAccepting)
+{
+    if (_isAccepting == isAccepting)
+        return;
+    if (isAccepting)
+        _application._dispatcher.subscribe(_fileno, EPOLLIN, this);
+    else
+        _application._dispatcher.unsubscribe(_fileno);
+    _isAccepting = isAccepting;
+}
+
+/* Accepts and immediately rejects a pending connection while no file descriptors are left */
+void HttpServer::rejectClient()
+{
+    // Free the reserved descriptor to make room for the connection
+    _application.releaseReserveFileno();
+
+    int fileno = accept(_fileno, NULL, NULL);
+    if (fileno >= 0)
+    {
+        ssize_t result = send(fileno, g_unavailableResponse, sizeof(g_unavailableResponse) - 1, MSG_DONTWAIT);
+        (void)result;
+        close(fileno);
+    }
+
+    // Take the descriptor back and stop accepting until a client has left
+    _application.acquireReserveFileno();
+    _application._isOutOfFilenos = true;
+    _application.updateListeners();
+}
@@ -3,14 +3,18 @@
 
 #include "config.hpp"
 #include "dispatcher.hpp"
+#include "buffer_pool.hpp"
 
 class Application;
 
 class HttpServer: public Sink
 {
 public:
-    /* Constructs an HTTP server according to its configuration */
-    HttpServer(Application &application, const ServerConfig &config);
+    friend class Application;
+
+    /* Constructs an HTTP server according to its configuration, adopting the given listening
+       socket instead of binding a new one if it is valid (eg. inherited during a binary upgrade) */
+    HttpServer(Application &application, const ServerConfig &config, int inheritedFileno = -1);
 
     /* Closes the server's listening socket */
     ~HttpServer();
@@ -20,10 +24,42 @@ public:
     {
         return _fileno;
     }
+
+    /* Gets the configuration the server was bound with */
+    inline const ServerConfig &getConfig()
+    {
+        return _config;
+    }
+
+    /* Gets the pool of the buffers every request header is received into */
+    inline BufferPool &getHeaderPool()
+    {
+        return _headerPool;
+    }
+
+    /* Gets the pool of the buffers borrowed by request headers which overflow their small buffer */
+    inline BufferPool &getLargeHeaderPool()
+    {
+        return _largeHeaderPool;
+    }
+
+    /* Gets the number of connections waiting to be accepted; returns 0 if not supported */
+    size_t getAcceptQueueDepth();
 private:
     Application        &_application;
     const ServerConfig &_config;
     int                 _fileno;
+    size_t              _clientCount;
+    bool                _isAccepting;
+    bool                _isAtConnectionLimit;
+    BufferPool          _headerPool;
+    BufferPool          _largeHeaderPool;
+
+    /* Starts or stops receiving new connections; pending ones queue up in the kernel backlog */
+    void setAccepting(bool isAccepting);
+
+    /* Accepts and immediately rejects a pending connection while no file descriptors are left */
+    void rejectClient();
 
     /* Handles one or multiple events */
     void handleEvents(uint32_t eventMask);
@@ -33,7 +33,7 @@ int main(int argc, char *argv[])
     // Start the application using the parsed configuration
     try
     {
-        Application application(config);
+        Application application(config, argv);
         application.configure();
         application.mainLoop();
     }
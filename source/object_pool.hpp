@@ -0,0 +1,154 @@
+#ifndef OBJECT_POOL_hpp
+#define OBJECT_POOL_hpp
+
+#include <new>
+#include <vector>
+#include <stddef.h>
+
+/* Number of objects allocated at once by an object pool */
+#define OBJECT_POOL_SLAB_SIZE 64
+
+/* Slab allocator for objects of a single type; memory of destroyed objects is kept on a free list
+   and reused for the next object instead of being returned to the heap */
+template <typename T>
+class ObjectPool
+{
+public:
+    /* Constructs an empty object pool */
+    ObjectPool()
+        : _freeSlots(NULL)
+        , _currentSlab(NULL)
+        , _slabRemainder(0)
+        , _capacity(0)
+        , _hits(0)
+        , _misses(0)
+    {
+    }
+
+    /* Releases all slabs; every object MUST have been destroyed already */
+    ~ObjectPool()
+    {
+        for (size_t index = 0; index < _slabs.size(); index++)
+            ::operator delete(_slabs[index]);
+    }
+
+    /* Allocates slabs until the pool holds at least the given number of objects */
+    void reserve(size_t count)
+    {
+        while (_capacity < count)
+        {
+            char *slab = allocateSlab();
+            for (size_t index = 0; index < OBJECT_POOL_SLAB_SIZE; index++)
+                pushFreeSlot(slab + index * SLOT_SIZE);
+        }
+    }
+
+    /* Gets uninitialized memory for one object, which must be constructed with placement new */
+    void *allocate()
+    {
+        if (_freeSlots != NULL)
+        {
+            _hits++;
+            FreeSlot *slot = _freeSlots;
+            _freeSlots = slot->next;
+            return slot;
+        }
+
+        // Only a new slab has to be taken from the heap
+        if (_slabRemainder == 0)
+        {
+            _currentSlab = allocateSlab();
+            _slabRemainder = OBJECT_POOL_SLAB_SIZE;
+            _misses++;
+        }
+        else
+            _hits++;
+        _slabRemainder--;
+        return _currentSlab + _slabRemainder * SLOT_SIZE;
+    }
+
+    /* Returns memory obtained by `allocate()` whose object was destroyed (or never constructed) */
+    void deallocate(void *memory)
+    {
+        pushFreeSlot(memory);
+    }
+
+    /* Destroys an object constructed in memory of this pool */
+    void destroy(T *object)
+    {
+        if (object == NULL)
+            return;
+        object->~T();
+        deallocate(object);
+    }
+
+    /* Gets the number of objects the allocated slabs can hold */
+    inline size_t capacity() const
+    {
+        return _capacity;
+    }
+
+    /* Gets the number of allocations that were served from memory owned by the pool */
+    inline size_t getHits() const
+    {
+        return _hits;
+    }
+
+    /* Gets the number of allocations that had to allocate a new slab */
+    inline size_t getMisses() const
+    {
+        return _misses;
+    }
+private:
+    struct FreeSlot
+    {
+        FreeSlot *next;
+    };
+
+    /* Objects are placed at multiples of the largest fundamental alignment */
+    enum
+    {
+        SLOT_ALIGNMENT = 16,
+        SLOT_SIZE = ((sizeof(T) > sizeof(FreeSlot) ? sizeof(T) : sizeof(FreeSlot)) + SLOT_ALIGNMENT - 1)
+                  / SLOT_ALIGNMENT * SLOT_ALIGNMENT
+    };
+
+    std::vector<char *> _slabs;
+    FreeSlot           *_freeSlots;
+    char               *_currentSlab;
+    size_t              _slabRemainder; // Never used slots at the start of `_currentSlab`
+    size_t              _capacity;
+    size_t              _hits;
+    size_t              _misses;
+
+    /* Allocates and registers a new slab */
+    char *allocateSlab()
+    {
+        char *slab = static_cast<char *>(::operator new(SLOT_SIZE * OBJECT_POOL_SLAB_SIZE));
+        try
+        {
+            _slabs.push_back(slab);
+        }
+        catch (...)
+        {
+            ::operator delete(slab);
+            throw;
+        }
+        _capacity += OBJECT_POOL_SLAB_SIZE;
+        return slab;
+    }
+
+    /* Puts a slot at the front of the free list */
+    void pushFreeSlot(void *memory)
+    {
+        FreeSlot *slot = static_cast<FreeSlot *>(memory);
+        slot->next = _freeSlots;
+        _freeSlots = slot;
+    }
+
+    /* Disable copy-construction and copy-assignment */
+    ObjectPool(const ObjectPool &other);
+    ObjectPool &operator=(const ObjectPool &other);
+};
+
+#endif // OBJECT_POOL_hpp
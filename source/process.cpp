@@ -11,7 +11,7 @@
 
 /* Starts a child process using the given constant string arrays
    The arrays must be NULL-terminated, see `man execve(2)` */
-Process::Process(const char **argArray, const char **envArray, const std::string &workingDirectory)
+Process::Process(const char **argArray, const char **envArray, const char *workingDirectory)
 {
     startChild(argArray, envArray, workingDirectory);
 }
@@ -21,7 +21,7 @@ Process::Process(const std::vector<std::string> &argVec, const std::vector<std::
 {
     std::vector<const char *> argvVector = toCharPointers(argVec);
     std::vector<const char *> envpVector = toCharPointers(envVec);
-    startChild(argvVector.data(), envpVector.data(), workingDirectory);
+    startChild(argvVector.data(), envpVector.data(), workingDirectory.c_str());
 }
 
 /* Kills the child process and closes the socket */
@@ -76,7 +76,7 @@ ProcessStatus Process::getStatus()
 }
 
 /* Starts a child process using the given constant string arrays */
-void Process::startChild(const char **argArray, const char **envArray, const std::string &workingDirectory)
+void Process::startChild(const char **argArray, const char **envArray, const char *workingDirectory)
 {
     // Set up pipes for communication with the child
     Pipe inputPipe, outputPipe;
@@ -98,9 +98,12 @@ void Process::startChild(const char **argArray, const char **envArray, const std
         close(inputPipe.writeFileno);
         close(outputPipe.readFileno);
 
+        // Ignored signals survive execve(), the CGI expects the default disposition
+        signal(SIGPIPE, SIG_DFL);
+
         // Change the working directory to the cgi directory
-        if (chdir(workingDirectory.c_str()) < 0)
-            std::exit(255);
+        if (chdir(workingDirectory) < 0)
+            _exit(255);
 
         // Only execute the process when both dup2() calls succeeded
         if (dup2(inputPipe.readFileno, STDIN_FILENO) >= 0 &&
@@ -109,8 +112,9 @@ void Process::startChild(const char **argArray, const char **envArray, const std
             execve(argArray[0], (char *const *)argArray, (char *const *)envArray);
         }
 
-        // If execve() ever returns or dup2() fails, exit the process immediately
-        std::exit(255);
+        // If execve() ever returns or dup2() fails, exit the process immediately; unlike `exit()`,
+        // `_exit()` neither runs the parent's exit handlers nor touches locks held by its other threads
+        _exit(255);
     }
 
     // Close the child-owned pipes and save the parent-owned pipes
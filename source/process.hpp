@@ -16,7 +16,7 @@ class Process
 public:
     /* Starts a child process using the given constant string arrays
        The arrays must be NULL-terminated, see `man execve(2)` */
-    Process(const char **argArray, const char **envArray, const std::string &workingDirectory);
+    Process(const char **argArray, const char **envArray, const char *workingDirectory);
 
     /* Starts a child process using the given dynamic string vectors */
     Process(const std::vector<std::string> &argVec, const std::vector<std::string> &envVec, const std::string &workingDirectory);
@@ -64,7 +64,7 @@ private:
     int           _outputFileno;
 
     /* Starts a child process using the given constant string arrays */
-    void startChild(const char **argArray, const char **envArray, const std::string &workingDirectory);
+    void startChild(const char **argArray, const char **envArray, const char *workingDirectory);
 
     /* Converts the given vector of C++ strings into a NULL-terminated vector of C strings */
     static std::vector<const char *> toCharPointers(const std::vector<std::string> &inputVec);
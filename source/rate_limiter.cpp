@@ -0,0 +1,97 @@
+#include "rate_limiter.hpp"
+#include "timeout.hpp"
+
+/* Constructs an empty entry; its bucket is filled on the first request */
+RateLimiter::Entry::Entry()
+    : connections(0)
+    , tokens(-1)
+    , updateTime(0)
+    , idleTime(0)
+{
+}
+
+/* Constructs an empty rate limiter */
+RateLimiter::RateLimiter()
+    : _sweepCursor(0)
+    , _nextSweepTime(0)
+{
+}
+
+/* Counts a connection of the client in the zone, returns false if the limit (0 is unlimited)
+   would be exceeded; accepted connections must be released using `releaseConnection()` */
+bool RateLimiter::acquireConnection(uint32_t host, uint32_t zone, size_t limit)
+{
+    if (limit == 0)
+        return true;
+
+    Entry &entry = _entries.findOrInsert(makeKey(host, zone), Entry());
+    if (entry.connections >= limit)
+        return false;
+    entry.connections++;
+    return true;
+}
+
+/* Releases a connection which was accepted by `acquireConnection()` */
+void RateLimiter::releaseConnection(uint32_t host, uint32_t zone)
+{
+    Entry *entry = _entries.find(makeKey(host, zone));
+    if (entry != NULL && entry->connections > 0)
+        entry->connections--;
+}
+
+/* Takes a token out of the client's bucket in the zone, returns false if the bucket is empty;
+   the bucket holds up to `burst + 1` tokens and is refilled by `rate` tokens per second */
+bool RateLimiter::acquireRequest(uint32_t host, uint32_t zone, double rate, size_t burst)
+{
+    if (rate <= 0)
+        return true;
+
+    uint64_t currentTime = Timeout::getCurrentTime();
+    double   capacity = static_cast<double>(burst) + 1;
+    Entry   &entry = _entries.findOrInsert(makeKey(host, zone), Entry());
+
+    // Refill the bucket according to the time passed since the last request
+    if (entry.tokens < 0)
+        entry.tokens = capacity;
+    else if (currentTime > entry.updateTime)
+    {
+        entry.tokens += static_cast<double>(currentTime - entry.updateTime) * rate / 1000;
+        if (entry.tokens > capacity)
+            entry.tokens = capacity;
+    }
+    entry.updateTime = currentTime;
+
+    if (entry.tokens < 1)
+        return false;
+    entry.tokens -= 1;
+
+    // Remember when the bucket is full again, from then on the entry can be dropped
+    entry.idleTime = currentTime + static_cast<uint64_t>((capacity - entry.tokens) * 1000 / rate) + 1;
+    return true;
+}
+
+/* Removes a portion of the entries which hold neither connections nor a partially empty bucket,
+   at most once per sweep interval; the table shrinks after each pass over it */
+void RateLimiter::sweep()
+{
+    uint64_t currentTime = Timeout::getCurrentTime();
+    if (_entries.capacity() == 0 || currentTime < _nextSweepTime)
+        return;
+    _nextSweepTime = currentTime + RATE_LIMITER_SWEEP_INTERVAL;
+
+    // Visit a sixteenth of the table, so that idle entries are dropped within a few seconds
+    size_t count = _entries.capacity() / 16;
+    if (count < RATE_LIMITER_SWEEP_SLOTS)
+        count = RATE_LIMITER_SWEEP_SLOTS;
+
+    IsExpired isExpired;
+    isExpired.currentTime = currentTime;
+    _entries.sweep(_sweepCursor, count, isExpired);
+
+    // Shrinking rehashes the whole table, so it is only attempted once the cursor wraps around
+    if ((_sweepCursor & (_entries.capacity() - 1)) < count)
+    {
+        _entries.shrink();
+        _sweepCursor = 0;
+    }
+}
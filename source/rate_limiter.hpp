@@ -0,0 +1,76 @@
+#ifndef RATE_LIMITER_hpp
+#define RATE_LIMITER_hpp
+
+#include "hash_table.hpp"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* The minimum number of table slots checked for expired entries per sweep */
+#define RATE_LIMITER_SWEEP_SLOTS 1024
+
+/* Milliseconds between two sweeps, so that busy loop iterations do not pay for one each */
+#define RATE_LIMITER_SWEEP_INTERVAL 100
+
+/* Tracks connections and request rates per client address and limit zone */
+class RateLimiter
+{
+public:
+    /* Constructs an empty rate limiter */
+    RateLimiter();
+
+    /* Counts a connection of the client in the zone, returns false if the limit (0 is unlimited)
+       would be exceeded; accepted connections must be released using `releaseConnection()` */
+    bool acquireConnection(uint32_t host, uint32_t zone, size_t limit);
+
+    /* Releases a connection which was accepted by `acquireConnection()` */
+    void releaseConnection(uint32_t host, uint32_t zone);
+
+    /* Takes a token out of the client's bucket in the zone, returns false if the bucket is empty;
+       the bucket holds up to `burst + 1` tokens and is refilled by `rate` tokens per second */
+    bool acquireRequest(uint32_t host, uint32_t zone, double rate, size_t burst);
+
+    /* Removes a portion of the entries which hold neither connections nor a partially empty bucket,
+       at most once per sweep interval; the table shrinks after each pass over it */
+    void sweep();
+
+    /* Gets the number of tracked entries */
+    inline size_t size() const
+    {
+        return _entries.size();
+    }
+private:
+    struct Entry
+    {
+        size_t   connections;
+        double   tokens;
+        uint64_t updateTime;
+        uint64_t idleTime;    // The time after which the bucket is full again
+
+        Entry();
+    };
+
+    /* Decides whether an entry carries no state anymore */
+    struct IsExpired
+    {
+        uint64_t currentTime;
+
+        inline bool operator()(uint64_t key, const Entry &entry) const
+        {
+            (void)key;
+            return entry.connections == 0 && entry.idleTime <= currentTime;
+        }
+    };
+
+    HashTable<uint64_t, Entry> _entries;
+    size_t                     _sweepCursor;
+    uint64_t                   _nextSweepTime;
+
+    /* Combines the client's address and the zone into a table key */
+    static inline uint64_t makeKey(uint32_t host, uint32_t zone)
+    {
+        return static_cast<uint64_t>(host) | (static_cast<uint64_t>(zone) << 32);
+    }
+};
+
+#endif // RATE_LIMITER_hpp
@@ -0,0 +1,56 @@
+#include "route_cache.hpp"
+#include "timeout.hpp"
+
+/* Constructs an empty route cache */
+RouteCache::RouteCache()
+    : _hits(0)
+    , _misses(0)
+{
+}
+
+/* Finds a recently resolved route on a server configuration using the given query path, returns NULL
+   if it has to be resolved (see `RoutingInfo::findRoute()`) and inserted again
+   NOTE: The returned pointer is only valid until the next insertion */
+const RoutingInfo *RouteCache::find(const ServerConfig &serverConfig, Slice queryPath)
+{
+    std::map<Key, Entry>::iterator entry = _entries.find(Key(&serverConfig, queryPath.toString()));
+    if (entry == _entries.end() || Timeout::getCurrentTime() >= entry->second.expiryTime)
+    {
+        _misses++;
+        return NULL;
+    }
+    _usage.splice(_usage.begin(), _usage, entry->second.usage);
+    _hits++;
+    return &entry->second.info;
+}
+
+/* Stores a route which was resolved for the given server configuration and query path */
+void RouteCache::insert(const ServerConfig &serverConfig, const std::string &queryPath, const RoutingInfo &info)
+{
+    Key                            key(&serverConfig, queryPath);
+    std::map<Key, Entry>::iterator entry = _entries.find(key);
+
+    if (entry != _entries.end())
+        _usage.splice(_usage.begin(), _usage, entry->second.usage);
+    else
+    {
+        // Make room for the new route first
+        if (_entries.size() >= ROUTE_CACHE_CAPACITY)
+        {
+            _entries.erase(_usage.back());
+            _usage.pop_back();
+        }
+        entry = _entries.insert(std::make_pair(key, Entry())).first;
+        entry->second.usage = _usage.insert(_usage.begin(), key);
+    }
+
+    entry->second.info       = info;
+    entry->second.expiryTime = Timeout::getCurrentTime() + ROUTE_CACHE_TTL_MS;
+}
+
+/* Forgets all resolved routes, used once the served file system was modified */
+void RouteCache::clear()
+{
+    _entries.clear();
+    _usage.clear();
+}
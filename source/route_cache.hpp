@@ -0,0 +1,75 @@
+#ifndef ROUTE_CACHE_hpp
+#define ROUTE_CACHE_hpp
+
+#include "routing.hpp"
+
+#include <map>
+#include <list>
+#include <string>
+#include <utility>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Maximum number of resolved routes kept in a route cache */
+#define ROUTE_CACHE_CAPACITY 4096
+
+/* Time (in milliseconds) for which a resolved route is reused before the file system is queried again */
+#define ROUTE_CACHE_TTL_MS 1000
+
+/* Keeps recently resolved routes (including negative results) per server and query path,
+   evicting the least recently used ones */
+class RouteCache
+{
+public:
+    /* Constructs an empty route cache */
+    RouteCache();
+
+    /* Finds a recently resolved route on a server configuration using the given query path, returns NULL
+       if it has to be resolved (see `RoutingInfo::findRoute()`) and inserted again
+       NOTE: The returned pointer is only valid until the next insertion */
+    const RoutingInfo *find(const ServerConfig &serverConfig, Slice queryPath);
+
+    /* Stores a route which was resolved for the given server configuration and query path */
+    void insert(const ServerConfig &serverConfig, const std::string &queryPath, const RoutingInfo &info);
+
+    /* Forgets all resolved routes, used once the served file system was modified */
+    void clear();
+
+    /* Gets the number of cached routes */
+    inline size_t size() const
+    {
+        return _entries.size();
+    }
+
+    /* Gets the number of lookups that were answered from the cache */
+    inline size_t getHits() const
+    {
+        return _hits;
+    }
+
+    /* Gets the number of lookups whose route had to be resolved */
+    inline size_t getMisses() const
+    {
+        return _misses;
+    }
+private:
+    typedef std::pair<const ServerConfig *, std::string> Key;
+
+    struct Entry
+    {
+        RoutingInfo              info;
+        uint64_t                 expiryTime;
+        std::list<Key>::iterator usage;
+    };
+
+    std::map<Key, Entry> _entries;
+    std::list<Key>       _usage; // Most recently used key first
+    size_t               _hits;
+    size_t               _misses;
+
+    /* Disable copy-construction and copy-assignment */
+    RouteCache(const RouteCache &other);
+    RouteCache &operator=(const RouteCache &other);
+};
+
+#endif // ROUTE_CACHE_hpp
@@ -40,7 +40,14 @@ RoutingInfo RoutingInfo::findRoute(const ServerConfig &serverConfig, Slice query
 
         // Build the full node path
         std::string path = config.rootDirectory + "/" + queryPath.cut(config.path.size()).stripStart('/').stripEnd('/').toString();
+#ifdef __42_LIKES_WASTING_CPU_CYCLES__
         nodeType = Utility::queryNodeType(path);
+#else
+        if (config.rootFileno >= 0)
+            nodeType = Utility::queryNodeType(config.rootFileno, config.getRelativePath(path));
+        else
+            nodeType = Utility::queryNodeType(path);
+#endif
 
         // Return early when a node exists but is not accessible
         if (nodeType == NODE_TYPE_NO_ACCESS || nodeType == NODE_TYPE_UNSUPPORTED)
@@ -0,0 +1,66 @@
+#include "server_name_index.hpp"
+
+#include <cctype>
+#include <algorithm>
+
+/* Hashes the lowercase characters of the name (FNV-1a) */
+uint64_t ServerNameTraits::hash(Slice name)
+{
+    uint64_t value = 0xcbf29ce484222325ull;
+    for (size_t index = 0; index < name.getLength(); index++)
+    {
+        value ^= static_cast<uint64_t>(std::tolower(static_cast<unsigned char>(name[index])));
+        value *= 0x100000001b3ull;
+    }
+    return value;
+}
+
+/* Adds a server name, names that were already added keep their first server */
+void ServerNameIndex::insert(const std::string &name, const ServerConfig *config)
+{
+    Slice slice(name);
+    if (slice.getLength() > 2 && slice.startsWith(C_SLICE("*.")))
+        _leadingWildcards.push_back(Wildcard(slice.cut(1), config));
+    else if (slice.getLength() > 2 && slice.endsWith(C_SLICE(".*")))
+        _trailingWildcards.push_back(Wildcard(Slice(&name[0], name.size() - 1), config));
+    else
+        _exactNames.findOrInsert(slice, config);
+}
+
+/* Sorts the wildcard names, must be called once all names were inserted */
+void ServerNameIndex::finalize()
+{
+    std::stable_sort(_leadingWildcards.begin(), _leadingWildcards.end(), compareLength);
+    std::stable_sort(_trailingWildcards.begin(), _trailingWildcards.end(), compareLength);
+}
+
+/* Finds the server with the given name, returns NULL if there is none */
+const ServerConfig *ServerNameIndex::find(Slice name) const
+{
+    const ServerConfig *const *exact = _exactNames.find(name);
+    if (exact != NULL)
+        return *exact;
+
+    // Wildcards only match if they leave at least one character of the name
+    for (size_t index = 0; index < _leadingWildcards.size(); index++)
+    {
+        Slice suffix = _leadingWildcards[index].first;
+        if (name.getLength() > suffix.getLength()
+         && name.cut(name.getLength() - suffix.getLength()).equalsIgnoreCase(suffix))
+            return _leadingWildcards[index].second;
+    }
+    for (size_t index = 0; index < _trailingWildcards.size(); index++)
+    {
+        Slice prefix = _trailingWildcards[index].first;
+        if (name.getLength() > prefix.getLength()
+         && Slice(&name[0], prefix.getLength()).equalsIgnoreCase(prefix))
+            return _trailingWildcards[index].second;
+    }
+    return NULL;
+}
+
+/* Orders wildcards by decreasing length, so that the most specific one matches first */
+bool ServerNameIndex::compareLength(const Wildcard &lhs, const Wildcard &rhs)
+{
+    return lhs.first.getLength() > rhs.first.getLength();
+}
@@ -0,0 +1,51 @@
+#ifndef SERVER_NAME_INDEX_hpp
+#define SERVER_NAME_INDEX_hpp
+
+#include "slice.hpp"
+#include "hash_table.hpp"
+
+#include <string>
+#include <vector>
+#include <utility>
+
+struct ServerConfig;
+
+/* Case-insensitive hashing and comparison for server names */
+struct ServerNameTraits
+{
+    /* Hashes the lowercase characters of the name (FNV-1a) */
+    static uint64_t hash(Slice name);
+
+    /* Compares two names ignoring their case */
+    static inline bool equals(Slice lhs, Slice rhs)
+    {
+        return lhs.equalsIgnoreCase(rhs);
+    }
+};
+
+/* Maps the server names of a binding to their virtual servers; exact names are looked up in a
+   hash table, wildcard names (`*.example.com`, `example.*`) are tried in order of decreasing length
+   NOTE: The names are not copied, the configurations MUST outlive the index */
+class ServerNameIndex
+{
+public:
+    /* Adds a server name, names that were already added keep their first server */
+    void insert(const std::string &name, const ServerConfig *config);
+
+    /* Sorts the wildcard names, must be called once all names were inserted */
+    void finalize();
+
+    /* Finds the server with the given name, returns NULL if there is none */
+    const ServerConfig *find(Slice name) const;
+private:
+    typedef std::pair<Slice, const ServerConfig *> Wildcard;
+
+    HashTable<Slice, const ServerConfig *, ServerNameTraits> _exactNames;
+    std::vector<Wildcard>                                    _leadingWildcards;  // Suffix including the dot
+    std::vector<Wildcard>                                    _trailingWildcards; // Prefix including the dot
+
+    /* Orders wildcards by decreasing length, so that the most specific one matches first */
+    static bool compareLength(const Wildcard &lhs, const Wildcard &rhs);
+};
+
+#endif // SERVER_NAME_INDEX_hpp
@@ -0,0 +1,54 @@
+#ifndef SHARED_STRING_hpp
+#define SHARED_STRING_hpp
+
+#include <string>
+#include <stddef.h>
+
+/* Reference-counted string that is shared by a cache and the responses sending it, so that neither
+   has to copy it and an evicted entry lives on until the last response is sent; only used on the
+   event loop's thread */
+class SharedString
+{
+public:
+    /* Creates a shared string holding a single reference, the contents are taken from `data` */
+    static SharedString *create(std::string &data)
+    {
+        SharedString *result = new SharedString();
+        result->_data.swap(data);
+        return result;
+    }
+
+    /* Takes another reference */
+    inline void acquire()
+    {
+        _references++;
+    }
+
+    /* Gives up a reference, the string is destroyed with the last one */
+    inline void release()
+    {
+        if (--_references == 0)
+            delete this;
+    }
+
+    /* Gets the shared contents */
+    inline const std::string &get() const
+    {
+        return _data;
+    }
+private:
+    std::string _data;
+    size_t      _references;
+
+    /* Constructs an empty string with a single reference */
+    SharedString()
+        : _references(1)
+    {
+    }
+
+    /* Disable copy-construction and copy-assignment */
+    SharedString(const SharedString &other);
+    SharedString &operator=(const SharedString &other);
+};
+
+#endif // SHARED_STRING_hpp
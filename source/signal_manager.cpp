@@ -6,6 +6,8 @@
 /** Registers various signal handlers */
 SignalManager::SignalManager()
     : _shouldQuit(false)
+    , _shouldUpgrade(false)
+    , _shouldReportStatus(false)
 {
     if (signal(SIGINT, handleQuitSignal) == SIG_ERR)
         throw std::runtime_error("Unable to register SIGINT");
@@ -13,6 +15,14 @@ SignalManager::SignalManager()
         throw std::runtime_error("Unable to register SIGQUIT");
     if (signal(SIGTERM, handleQuitSignal) == SIG_ERR)
         throw std::runtime_error("Unable to register SIGTERM");
+    if (signal(SIGUSR2, handleUpgradeSignal) == SIG_ERR)
+        throw std::runtime_error("Unable to register SIGUSR2");
+    if (signal(SIGUSR1, handleStatusSignal) == SIG_ERR)
+        throw std::runtime_error("Unable to register SIGUSR1");
+
+    // `sendfile()` cannot suppress SIGPIPE per call, a closed socket is reported by EPIPE instead
+    if (signal(SIGPIPE, SIG_IGN) == SIG_ERR)
+        throw std::runtime_error("Unable to ignore SIGPIPE");
 }
 
 /** Handles various quit-type signals */
@@ -22,4 +32,18 @@ void SignalManager::handleQuitSignal(int number)
     _instance._shouldQuit = true;
 }
 
+/** Handles the binary upgrade signal */
+void SignalManager::handleUpgradeSignal(int number)
+{
+    (void)number;
+    _instance._shouldUpgrade = true;
+}
+
+/** Handles the status report signal */
+void SignalManager::handleStatusSignal(int number)
+{
+    (void)number;
+    _instance._shouldReportStatus = true;
+}
+
 SignalManager SignalManager::_instance;
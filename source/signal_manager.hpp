@@ -11,13 +11,39 @@ public:
     {
         return _instance._shouldQuit;
     }
+
+    /** Gets if a binary upgrade was requested and resets the request */
+    static inline bool takeUpgradeRequest()
+    {
+        if (!_instance._shouldUpgrade)
+            return false;
+        _instance._shouldUpgrade = false;
+        return true;
+    }
+
+    /** Gets if a status report was requested and resets the request */
+    static inline bool takeStatusRequest()
+    {
+        if (!_instance._shouldReportStatus)
+            return false;
+        _instance._shouldReportStatus = false;
+        return true;
+    }
 private:
     static SignalManager _instance;
     volatile bool        _shouldQuit;
+    volatile bool        _shouldUpgrade;
+    volatile bool        _shouldReportStatus;
 
     /** Handles various quit-type signals */
     static void handleQuitSignal(int number);
 
+    /** Handles the binary upgrade signal */
+    static void handleUpgradeSignal(int number);
+
+    /** Handles the status report signal */
+    static void handleStatusSignal(int number);
+
     /* Disable copy-construction and copy-assignment */
     SignalManager(const SignalManager &other);
     SignalManager &operator=(const SignalManager &other);
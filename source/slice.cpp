@@ -2,6 +2,7 @@
 #include "utility.hpp"
 
 #include <ostream>
+#include <cctype>
 #include <cstring>
 
 /* Comparison to other slice */
@@ -20,6 +21,21 @@ bool Slice::operator!=(Slice other)
     return std::memcmp(_string, other._string, _length) != 0;
 }
 
+/* Case-invariant comparison to other slice */
+bool Slice::equalsIgnoreCase(Slice other) const
+{
+    if (_length != other._length)
+        return false;
+    for (size_t index = 0; index < _length; index++)
+    {
+        // Plain chars may be negative, which `std::tolower()` does not accept
+        if (std::tolower(static_cast<unsigned char>(_string[index]))
+         != std::tolower(static_cast<unsigned char>(other._string[index])))
+            return false;
+    }
+    return true;
+}
+
 /* Removes the slice's start until `delimiter` is reached and populates `outSlice` with it,
    the current slice will be the remainder excluding the delimiter */
 bool Slice::splitStart(char delimiter, Slice &outStart)
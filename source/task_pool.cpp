@@ -0,0 +1,224 @@
+#include "task_pool.hpp"
+#include "signal_manager.hpp"
+
+#include <errno.h>
+#include <unistd.h>
+#include <stdexcept>
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+# include <signal.h>
+# include <sys/eventfd.h>
+#endif // __42_LIKES_WASTING_CPU_CYCLES__
+
+/* Initializes the task's link */
+Task::Task()
+    : _next(NULL)
+{
+}
+
+/* Destructor for deriving classes */
+Task::~Task()
+{
+}
+
+/* Constructs a task pool without any worker threads */
+TaskPool::TaskPool(Dispatcher &dispatcher)
+    : _dispatcher(dispatcher)
+    , _threadCount(0)
+    , _pendingCount(0)
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+    , _fileno(-1)
+    , _queueHead(NULL)
+    , _queueTail(NULL)
+    , _completed(NULL)
+    , _isStopping(false)
+#endif // __42_LIKES_WASTING_CPU_CYCLES__
+{
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+    pthread_mutex_init(&_mutex, NULL);
+    pthread_cond_init(&_condition, NULL);
+#endif // __42_LIKES_WASTING_CPU_CYCLES__
+}
+
+/* Waits for the worker threads to finish their current task and destroys all tasks without finishing them */
+TaskPool::~TaskPool()
+{
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+    // Queued tasks are abandoned, a blocked file system call delays the exit though
+    pthread_mutex_lock(&_mutex);
+    _isStopping = true;
+    pthread_cond_broadcast(&_condition);
+    pthread_mutex_unlock(&_mutex);
+    for (size_t index = 0; index < _threads.size(); index++)
+        pthread_join(_threads[index], NULL);
+
+    Task *lists[] = { _queueHead, _completed };
+    for (size_t index = 0; index < sizeof(lists) / sizeof(lists[0]); index++)
+    {
+        while (lists[index] != NULL)
+        {
+            Task *next = lists[index]->_next;
+            delete lists[index];
+            lists[index] = next;
+        }
+    }
+
+    if (_fileno >= 0)
+        close(_fileno);
+    pthread_cond_destroy(&_condition);
+    pthread_mutex_destroy(&_mutex);
+#endif // __42_LIKES_WASTING_CPU_CYCLES__
+}
+
+/* Starts the given number of worker threads and subscribes to their completions */
+void TaskPool::start(size_t threadCount)
+{
+#ifdef __42_LIKES_WASTING_CPU_CYCLES__
+    (void)threadCount;
+#else
+    if ((_fileno = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+        throw std::runtime_error("Unable to create task completion eventfd");
+    _dispatcher.subscribe(_fileno, EPOLLIN, this);
+    _threads.reserve(threadCount);
+
+    // Signals are left to the event loop's thread, the workers inherit the blocked mask
+    sigset_t blockedSignals, previousSignals;
+    sigfillset(&blockedSignals);
+    pthread_sigmask(SIG_SETMASK, &blockedSignals, &previousSignals);
+    while (_threads.size() < threadCount)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, runWorker, this) != 0)
+            break;
+        _threads.push_back(thread);
+    }
+    pthread_sigmask(SIG_SETMASK, &previousSignals, NULL);
+
+    // Fewer threads only slow the tasks down, without any the tasks are performed right away
+    _threadCount = _threads.size();
+#endif // __42_LIKES_WASTING_CPU_CYCLES__
+}
+
+/* Takes ownership of the task and performs it; it is finished and destroyed during a later dispatch,
+   or right away if the pool has no worker threads */
+void TaskPool::submit(Task *task)
+{
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+    if (_threadCount > 0)
+    {
+        pthread_mutex_lock(&_mutex);
+        task->_next = NULL;
+        if (_queueTail != NULL)
+            _queueTail->_next = task;
+        else
+            _queueHead = task;
+        _queueTail = task;
+        pthread_cond_signal(&_condition);
+        pthread_mutex_unlock(&_mutex);
+        _pendingCount++;
+        return;
+    }
+#endif // __42_LIKES_WASTING_CPU_CYCLES__
+
+    try
+    {
+        task->execute();
+        task->finish();
+    }
+    catch (...)
+    {
+        delete task;
+        throw;
+    }
+    delete task;
+}
+
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+
+/* Entry point of the worker threads */
+void *TaskPool::runWorker(void *pointer)
+{
+    TaskPool &pool = *static_cast<TaskPool *>(pointer);
+
+    pthread_mutex_lock(&pool._mutex);
+    while (true)
+    {
+        while (pool._queueHead == NULL && !pool._isStopping)
+            pthread_cond_wait(&pool._condition, &pool._mutex);
+        if (pool._isStopping)
+            break;
+        Task *task = pool._queueHead;
+        pool._queueHead = task->_next;
+        if (pool._queueHead == NULL)
+            pool._queueTail = NULL;
+        pthread_mutex_unlock(&pool._mutex);
+
+        // Tasks report their failures through their result, nothing may escape the thread
+        try
+        {
+            task->execute();
+        }
+        catch (...)
+        {
+        }
+
+        // Only the first completion after the event loop took the list has to wake it up
+        pthread_mutex_lock(&pool._mutex);
+        task->_next = pool._completed;
+        pool._completed = task;
+        if (task->_next == NULL)
+        {
+            uint64_t value = 1;
+            ssize_t  result = write(pool._fileno, &value, sizeof(value));
+            (void)result;
+        }
+    }
+    pthread_mutex_unlock(&pool._mutex);
+    return NULL;
+}
+
+#endif // __42_LIKES_WASTING_CPU_CYCLES__
+
+/* Handles one or multiple events */
+void TaskPool::handleEvents(uint32_t eventMask)
+{
+    (void)eventMask;
+
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+    // The counter is reset before the list is taken, so no completion is missed
+    uint64_t value;
+    if (read(_fileno, &value, sizeof(value)) < 0 && errno != EAGAIN)
+    {
+        if (SignalManager::shouldQuit())
+            return;
+        throw std::runtime_error("Unable to read from task completion eventfd");
+    }
+
+    pthread_mutex_lock(&_mutex);
+    Task *task = _completed;
+    _completed = NULL;
+    pthread_mutex_unlock(&_mutex);
+
+    while (task != NULL)
+    {
+        Task *next = task->_next;
+
+        // A failing task must not keep the others from finishing
+        _pendingCount--;
+        try
+        {
+            task->finish();
+        }
+        catch (...)
+        {
+        }
+        delete task;
+        task = next;
+    }
+#endif // __42_LIKES_WASTING_CPU_CYCLES__
+}
+
+/* Handles an exception that occurred in `handleEvent()` */
+void TaskPool::handleException(const char *message)
+{
+    (void)message;
+}
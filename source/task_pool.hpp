@@ -0,0 +1,99 @@
+#ifndef TASK_POOL_hpp
+#define TASK_POOL_hpp
+
+#include "dispatcher.hpp"
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+# include <pthread.h>
+#endif // __42_LIKES_WASTING_CPU_CYCLES__
+
+/* Number of worker threads performing blocking file system operations */
+#define TASK_POOL_THREAD_COUNT 4
+
+/* Blocking operation that is performed off the event loop */
+class Task
+{
+public:
+    friend class TaskPool;
+
+    /* Initializes the task's link */
+    Task();
+
+    /* Destructor for deriving classes */
+    virtual ~Task();
+
+    /* Performs the operation on a worker thread; MUST only touch data owned by the task */
+    virtual void execute() = 0;
+
+    /* Delivers the operation's result on the event loop's thread */
+    virtual void finish() = 0;
+private:
+    Task *_next; // Links the tasks of the pool's queue and its completion list
+
+    /* Disable copy-construction and copy-assignment */
+    Task(const Task &other);
+    Task &operator=(const Task &other);
+};
+
+/* Performs tasks on worker threads and delivers their completions to the dispatcher through an eventfd;
+   without threads (42 mode) tasks are performed immediately */
+class TaskPool: public Sink
+{
+public:
+    /* Constructs a task pool without any worker threads */
+    TaskPool(Dispatcher &dispatcher);
+
+    /* Waits for the worker threads to finish their current task and destroys all tasks without finishing them */
+    ~TaskPool();
+
+    /* Starts the given number of worker threads and subscribes to their completions */
+    void start(size_t threadCount);
+
+    /* Takes ownership of the task and performs it; it is finished and destroyed during a later dispatch,
+       or right away if the pool has no worker threads */
+    void submit(Task *task);
+
+    /* Gets the number of worker threads */
+    inline size_t getThreadCount() const
+    {
+        return _threadCount;
+    }
+
+    /* Gets the number of tasks which were submitted but are not finished yet */
+    inline size_t getPendingCount() const
+    {
+        return _pendingCount;
+    }
+private:
+    Dispatcher            &_dispatcher;
+    size_t                 _threadCount;
+    size_t                 _pendingCount; // Only accessed on the event loop's thread
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+    std::vector<pthread_t> _threads;
+    int                    _fileno;    // Eventfd which becomes readable once tasks are completed
+    pthread_mutex_t        _mutex;     // Guards everything below
+    pthread_cond_t         _condition; // Signaled when a task is queued or the pool stops
+    Task                  *_queueHead;
+    Task                  *_queueTail;
+    Task                  *_completed;
+    bool                   _isStopping;
+
+    /* Entry point of the worker threads */
+    static void *runWorker(void *pool);
+#endif // __42_LIKES_WASTING_CPU_CYCLES__
+
+    /* Handles one or multiple events */
+    void handleEvents(uint32_t eventMask);
+
+    /* Handles an exception that occurred in `handleEvent()` */
+    void handleException(const char *message);
+
+    /* Disable copy-construction and copy-assignment */
+    TaskPool(const TaskPool &other);
+    TaskPool &operator=(const TaskPool &other);
+};
+
+#endif // TASK_POOL_hpp
@@ -3,6 +3,9 @@
 #include <ctime>
 #include <stdexcept>
 
+uint64_t Timeout::_currentTime = Timeout::queryCurrentTime();
+time_t   Timeout::_currentDate = std::time(NULL);
+
 /* Constructs a timeout starting from the current time */
 Timeout::Timeout(uint64_t duration)
     : _duration(duration)
@@ -34,8 +37,15 @@ void Timeout::stop()
     _isStopped = true;
 }
 
-/* Queries the current time from the operating system */
-uint64_t Timeout::getCurrentTime()
+/* Queries the current time from the operating system, which is done once per event loop iteration */
+void Timeout::updateCurrentTime()
+{
+    _currentTime = queryCurrentTime();
+    _currentDate = std::time(NULL);
+}
+
+/* Queries the current monotonic time (in milliseconds) from the operating system */
+uint64_t Timeout::queryCurrentTime()
 {
 #ifdef __42_LIKES_WASTING_CPU_CYCLES__
     // There is neither an C function allowed by subject nor a C++98
@@ -1,11 +1,21 @@
 #ifndef TIMEOUT_hpp
 #define TIMEOUT_hpp
 
+#include <ctime>
 #include <stdint.h>
 
-/* The timeout for a client to make a request */
+/* The default timeout for a client to send the whole request header */
 #define TIMEOUT_REQUEST_MS 5000
 
+/* The default timeout between two reads of a request body */
+#define TIMEOUT_BODY_MS 10000
+
+/* The default timeout between two writes of a response */
+#define TIMEOUT_SEND_MS 10000
+
+/* The time a client is given before its transfer rate is checked against the minimum data rate */
+#define TIMEOUT_MIN_DATA_RATE_GRACE_MS 5000
+
 /* The timeout for a client to close the connection after receiving a response */
 #define TIMEOUT_CLOSING_MS 500
 
@@ -32,13 +42,31 @@ public:
     {
         return _isStopped;
     }
+
+    /* Gets the monotonic time (in milliseconds) at which the event loop last woke up */
+    static inline uint64_t getCurrentTime()
+    {
+        return _currentTime;
+    }
+
+    /* Gets the wall-clock time (in seconds) at which the event loop last woke up */
+    static inline time_t getCurrentDate()
+    {
+        return _currentDate;
+    }
+
+    /* Queries the current time from the operating system, which is done once per event loop iteration */
+    static void updateCurrentTime();
 private:
     uint64_t _duration;
     uint64_t _startTime;
     bool     _isStopped;
 
-    /* Queries the current time from the operating system */
-    static uint64_t getCurrentTime();
+    static uint64_t _currentTime;
+    static time_t   _currentDate;
+
+    /* Queries the current monotonic time (in milliseconds) from the operating system */
+    static uint64_t queryCurrentTime();
 };
 
 #endif // TIMEOUT_hpp
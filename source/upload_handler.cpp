@@ -1,19 +1,14 @@
 #include "upload_handler.hpp"
 #include "http_exception.hpp"
+#include "utility.hpp"
 
 #include <fstream>
 
 /* Attempts to parse the request's `Content-Type` header to obtain the form boundary */
-static bool extractBoundary(const HttpRequest &request, Slice &outBoundary)
+static bool extractBoundary(Slice contentType, Slice &outBoundary)
 {
     Slice prefix;
 
-    // Check if the content type header is present
-    const HttpRequest::Header *contentTypeHeader = request.findHeader(C_SLICE("Content-Type"));
-    if (contentTypeHeader == NULL)
-        return false;
-    Slice contentType = contentTypeHeader->getValue();
-
     // Check if the content type is form data
     if (!contentType.splitStart(';', prefix))
         return false;
@@ -96,7 +91,7 @@ static bool extractFileName(Slice header, Slice &outFileName)
 }
 
 /* Handles the content between form boundaries */
-static void handleField(Slice field, const RoutingInfo &routingInfo)
+static void handleField(Slice field, const std::string &directoryPath)
 {
     Slice header;
     Slice fileName;
@@ -110,7 +105,7 @@ static void handleField(Slice field, const RoutingInfo &routingInfo)
     // Clamp the file name to not go below the upload directory and assemble the full path
     if (!Utility::checkPathLevel(fileName))
         throw HttpException(403);
-    std::string path = Slice(routingInfo.nodePath).stripEnd('/').toString() + '/' + fileName.toString();
+    std::string path = Slice(directoryPath).stripEnd('/').toString() + '/' + fileName.toString();
 
     // Attempt to write the file
     std::ofstream stream(path.c_str(), std::ios::binary | std::ios::trunc);
@@ -121,15 +116,15 @@ static void handleField(Slice field, const RoutingInfo &routingInfo)
         throw HttpException(500);
 }
 
-/* Handles the upload of one or multiple files */
-void UploadHandler::handleUpload(const HttpRequest &request, const RoutingInfo &routingInfo)
+/* Handles the upload of one or multiple files into the given directory; only touches the given
+   data, so it may be used on any thread */
+void UploadHandler::handleUpload(Slice contentType, Slice body, const std::string &directoryPath)
 {
-    Slice body(request.body);
     Slice field;
 
     // Extract the form boundary from the request's content type header
     Slice boundarySlice;
-    if (!extractBoundary(request, boundarySlice))
+    if (!extractBoundary(contentType, boundarySlice))
         throw HttpException(400);
     std::string boundary = "--" + boundarySlice.toString();
 
@@ -150,7 +145,7 @@ void UploadHandler::handleUpload(const HttpRequest &request, const RoutingInfo &
         // Extract and handle the form field up to the next boundary
         if (!body.splitStart(boundary, field))
             throw HttpException(400);
-        handleField(field, routingInfo);
+        handleField(field, directoryPath);
 
         // Break if the final boundary is reached
         if (body.consumeStart(C_SLICE("--")))
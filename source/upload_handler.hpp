@@ -1,13 +1,15 @@
 #ifndef UPLOAD_HANDLER_hpp
 #define UPLOAD_HANDLER_hpp
 
-#include "routing.hpp"
-#include "http_request.hpp"
+#include "slice.hpp"
+
+#include <string>
 
 namespace UploadHandler
 {
-    /* Handles the upload of one or multiple files */
-    void handleUpload(const HttpRequest &request, const RoutingInfo &routingInfo);
+    /* Handles the upload of one or multiple files into the given directory; only touches the given
+       data, so it may be used on any thread */
+    void handleUpload(Slice contentType, Slice body, const std::string &directoryPath);
 };
 
 #endif // UPLOAD_HANDLER_hpp
@@ -7,6 +7,11 @@
 #include <sys/stat.h>
 #include <cstring>
 #include <netdb.h>
+#include <fcntl.h>
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+# include <sys/syscall.h>
+# include <linux/openat2.h>
+#endif
 
 /* Finds the substring `needle` in the given string `haystack` */
 const void *Utility::find(const void *haystack, size_t haystackLength, const void *needle, size_t needleLength)
@@ -75,6 +80,59 @@ NodeType Utility::queryNodeType(const char *path)
     return NODE_TYPE_UNSUPPORTED;
 }
 
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+
+/* Opens a path relative to the directory, the kernel refuses to resolve it outside of the directory
+   or through magic links; returns -1 and sets `errno` on failure */
+int Utility::openBeneath(int directoryFileno, const char *path, int flags)
+{
+    static bool isSupported = true;
+
+    if (isSupported)
+    {
+        open_how how;
+        std::memset(&how, 0, sizeof(how));
+        how.flags   = static_cast<uint64_t>(flags);
+        how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+        long result = syscall(SYS_openat2, directoryFileno, path, &how, sizeof(how));
+        if (result >= 0 || errno != ENOSYS)
+            return static_cast<int>(result);
+        isSupported = false;
+    }
+
+    // Older kernels can only rely on request paths being normalized, which never contain ".."
+    return openat(directoryFileno, path, flags);
+}
+
+/* Queries the type of node at the given path relative to the directory, which it may not leave */
+NodeType Utility::queryNodeType(int directoryFileno, const char *path)
+{
+    struct stat result;
+
+    // Opening for reading checks the permissions as well, FIFOs must not block the open
+    int fileno = openBeneath(directoryFileno, path, O_RDONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+    if (fileno < 0)
+    {
+        if (errno == EACCES || errno == EXDEV || errno == ELOOP)
+            return NODE_TYPE_NO_ACCESS;
+        if (errno == ENOENT || errno == ENOTDIR)
+            return NODE_TYPE_NOT_FOUND;
+        throw std::runtime_error("Unable to query file information");
+    }
+    int status = fstat(fileno, &result);
+    close(fileno);
+    if (status != 0)
+        throw std::runtime_error("Unable to query file information");
+
+    if (S_ISREG(result.st_mode))
+        return NODE_TYPE_REGULAR;
+    if (S_ISDIR(result.st_mode))
+        return NODE_TYPE_DIRECTORY;
+    return NODE_TYPE_UNSUPPORTED;
+}
+
+#endif // __42_LIKES_WASTING_CPU_CYCLES__
+
 /* Checks whether the given path exceeds the root path, returns true if it doesn't */
 bool Utility::checkPathLevel(Slice path)
 {
@@ -151,6 +209,24 @@ bool Utility::parseSize(Slice string, size_t &outResult)
     return true;
 }
 
+/* Writes the decimal digits of a `size_t` to the buffer, which must hold `UTILITY_SIZE_DIGITS`
+   characters; returns the number of digits */
+size_t Utility::formatSize(size_t number, char *buffer)
+{
+    // Write the digits from the back of a scratch buffer, then move them to the front
+    char   digits[UTILITY_SIZE_DIGITS];
+    size_t index = sizeof(digits);
+    do
+    {
+        digits[--index] = '0' + number % 10;
+        number /= 10;
+    } while (number > 0);
+
+    size_t length = sizeof(digits) - index;
+    std::memcpy(buffer, &digits[index], length);
+    return length;
+}
+
 /* Attempts to convert a hexadecimal character (0-9, A-F, a-f) into its numeric value (0-15) */
 bool Utility::parseHexChar(char character, uint8_t &outResult)
 {
@@ -191,38 +267,126 @@ bool Utility::parseSizeHex(Slice string, size_t &outResult)
     return true;
 }
 
-/* Attempts to convert a URL-encoded string slice to a URL-decoded string */
-bool Utility::decodeUrl(Slice string, std::string &outResult)
+/* Drops the segment written last if it is "." or removes it together with the previous one if it is "..",
+   returns false if ".." would leave the root */
+static bool resolveSegment(char *outBuffer, size_t &outLength, size_t &segmentStart, size_t rootLength)
 {
-    std::stringstream stream;
-    uint8_t           upperFour, lowerFour;
+    const char *segment = &outBuffer[segmentStart];
+    size_t      length = outLength - segmentStart;
 
-    for (size_t index = 0; index < string.getLength(); index++)
+    if (length == 1 && segment[0] == '.')
+        outLength = segmentStart;
+    else if (length == 2 && segment[0] == '.' && segment[1] == '.')
+    {
+        if (segmentStart <= rootLength)
+            return false;
+
+        // Step back over the previous segment, keeping the slash in front of it
+        size_t previous = segmentStart - 1;
+        while (previous > rootLength && outBuffer[previous - 1] != '/')
+            previous--;
+        outLength = previous;
+        segmentStart = previous;
+    }
+    return true;
+}
+
+/* Attempts to URL-decode a path while collapsing repeated slashes, dropping "." and resolving ".."
+   segments in a single pass; fails on bad encodings, NUL characters and paths that leave the root.
+   `outBuffer` must hold at least as many characters as the encoded path */
+bool Utility::normalizePath(Slice path, char *outBuffer, size_t &outLength)
+{
+    uint8_t upperFour, lowerFour;
+    size_t  index = 0;
+    size_t  rootLength = 0;
+
+    // An absolute path keeps its leading slash, segments are never removed in front of it
+    outLength = 0;
+    if (!path.isEmpty() && path[0] == '/')
     {
-        // Handle special characters
-        if (string[index] == '%')
+        outBuffer[outLength++] = '/';
+        rootLength = 1;
+        index = 1;
+    }
+    size_t segmentStart = rootLength;
+
+    while (index < path.getLength())
+    {
+        // Copy runs of characters without any special meaning at once
+        size_t runEnd = index;
+        while (runEnd < path.getLength() && path[runEnd] != '%' && path[runEnd] != '+' && path[runEnd] != '/')
+            runEnd++;
+        if (runEnd != index)
         {
-            // Check if there are enough characters left (2 hex digits after '%')
-            if (string.getLength() - index < 3)
-                return false;
+            std::memcpy(&outBuffer[outLength], &path[index], runEnd - index);
+            outLength += runEnd - index;
+            index = runEnd;
+            continue;
+        }
 
-            // Parse the two hex digits
-            if (!parseHexChar(string[index + 1], upperFour))
+        char character = path[index];
+        if (character == '%')
+        {
+            // Expect two hex digits after '%', which must not encode a NUL character
+            if (path.getLength() - index < 3)
                 return false;
-            if (!parseHexChar(string[index + 2], lowerFour))
+            if (!parseHexChar(path[index + 1], upperFour) || !parseHexChar(path[index + 2], lowerFour))
                 return false;
-
-            // Combine the digits and write it to the string as a character
-            stream << static_cast<char>((upperFour << 4) | lowerFour);
-            index += 2; // The last character will be consumed by the loop
+            character = static_cast<char>((upperFour << 4) | lowerFour);
+            if (character == '\0')
+                return false;
+            index += 3;
         }
-        // Handle the '+' character as a space
-        else if (string[index] == '+')
-            stream << ' ';
         else
-            stream << string[index];
+        {
+            // Handle the '+' character as a space
+            if (character == '+')
+                character = ' ';
+            index++;
+        }
+
+        if (character != '/')
+        {
+            outBuffer[outLength++] = character;
+            continue;
+        }
+
+        // A slash completes the current segment, empty segments collapse into the previous slash
+        if (!resolveSegment(outBuffer, outLength, segmentStart, rootLength))
+            return false;
+        if (outLength != segmentStart)
+        {
+            outBuffer[outLength++] = '/';
+            segmentStart = outLength;
+        }
     }
 
-    outResult = stream.str();
+    // The trailing segment is resolved like all others, a removed one leaves its slash behind
+    return resolveSegment(outBuffer, outLength, segmentStart, rootLength);
+}
+
+/* Formats a timestamp as an HTTP date; eg. "Sun, 06 Nov 1994 08:49:37 GMT" */
+std::string Utility::formatHttpDate(time_t time)
+{
+    char buffer[64];
+    tm   parts;
+
+    // The C locale's names are the ones required by HTTP
+    gmtime_r(&time, &parts);
+    size_t length = std::strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &parts);
+    return std::string(buffer, length);
+}
+
+/* Attempts to parse an HTTP date in the format produced by `formatHttpDate()` */
+bool Utility::parseHttpDate(Slice string, time_t &outResult)
+{
+    std::string terminated = string.toString();
+    tm          parts;
+
+    std::memset(&parts, 0, sizeof(parts));
+    const char *end = strptime(terminated.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &parts);
+    if (end == NULL || *end != '\0')
+        return false;
+    outResult = timegm(&parts);
     return true;
 }
@@ -10,6 +10,7 @@
 #include <sstream>
 #include <cstddef>
 #include <stdint.h>
+#include <ctime>
 
 enum NodeType
 {
@@ -21,6 +22,9 @@ enum NodeType
     NODE_TYPE_UNSUPPORTED
 };
 
+/* Maximum number of decimal digits of a `size_t` */
+#define UTILITY_SIZE_DIGITS 20
+
 namespace Utility
 {
     /* Finds the substring `needle` in the given string `haystack` */
@@ -47,6 +51,15 @@ namespace Utility
         return queryNodeType(path.c_str());
     }
 
+#ifndef __42_LIKES_WASTING_CPU_CYCLES__
+    /* Opens a path relative to the directory, the kernel refuses to resolve it outside of the directory
+       or through magic links; returns -1 and sets `errno` on failure */
+    int openBeneath(int directoryFileno, const char *path, int flags);
+
+    /* Queries the type of node at the given path relative to the directory, which it may not leave */
+    NodeType queryNodeType(int directoryFileno, const char *path);
+#endif
+
     /* Checks whether the given path exceeds the root path, returns true if it doesn't */
     bool checkPathLevel(Slice path);
 
@@ -56,14 +69,26 @@ namespace Utility
     /* Attempts to convert a string slice to a `size_t` */
     bool parseSize(Slice string, size_t &outResult);
 
+    /* Writes the decimal digits of a `size_t` to the buffer, which must hold `UTILITY_SIZE_DIGITS`
+       characters; returns the number of digits */
+    size_t formatSize(size_t number, char *buffer);
+
     /* Attempts to convert a hexadecimal character (0-9, A-F, a-f) into its numeric value (0-15) */
     bool parseHexChar(char character, uint8_t &outResult);
 
     /* Attempts to convert a string slice to a `size_t` */
     bool parseSizeHex(Slice string, size_t &outResult);
 
-    /* Attempts to convert a URL-encoded string slice to a URL-decoded string */
-    bool decodeUrl(Slice string, std::string &outResult);
+    /* Attempts to URL-decode a path while collapsing repeated slashes, dropping "." and resolving ".."
+       segments in a single pass; fails on bad encodings, NUL characters and paths that leave the root.
+       `outBuffer` must hold at least as many characters as the encoded path */
+    bool normalizePath(Slice path, char *outBuffer, size_t &outLength);
+
+    /* Formats a timestamp as an HTTP date; eg. "Sun, 06 Nov 1994 08:49:37 GMT" */
+    std::string formatHttpDate(time_t time);
+
+    /* Attempts to parse an HTTP date in the format produced by `formatHttpDate()` */
+    bool parseHttpDate(Slice string, time_t &outResult);
 }
 
 #endif // UTILITY_hpp